@@ -51,20 +51,36 @@ struct gate_t
     std::vector<input_element_t<FieldT> > input_gates;
 };
 
+/************************** CIRCUIT OPTIMIZATION *****************************/
+
+/* Gate counts before and after optimize(), and the number of rewrites per pass */
+struct optimization_stats_t
+{
+    size_t gates_before;
+    size_t gates_after;
+    size_t folded;      // Gates folded into a constant or an operand
+    size_t merged;      // Gates merged with an identical earlier gate
+    size_t flattened;   // Gates spliced into a gate of the same type
+    size_t removed;     // Gates removed as not feeding any output
+};
+
 /*************************** ARITHMETIC CIRCUIT ******************************/
 
 template<typename FieldT>
 class arithmetic_circuit_t {
 public:
-    arithmetic_circuit_t(const size_t &input_size) : _input_size(input_size) {};
+    arithmetic_circuit_t(const size_t &input_size) : _input_size(input_size), _min_degree(0) {};
 
     /*
-     * Returns the evaluation of the circuit for the given input. Note that
-     * the size of input_t must match the circuit's input size. If the circuit
-     * contains no gates, the evaluation will return 0.
+     * Returns the evaluation of the circuit's first output for the given
+     * input. Note that the size of input_t must match the circuit's input
+     * size. The circuit must contain at least one gate.
      */
     FieldT evaluate(const input_t<FieldT> &input) const;
 
+    /* Returns the evaluations of all outputs of the circuit, in order */
+    std::vector<FieldT> evaluate_outputs(const input_t<FieldT> &input) const;
+
     /* 
      * Adds the provided gate to the circuit. Each gate is composed of
      * two parts, a gate type (ex. SUM, PRODUCT) and a vector of input gates.
@@ -82,19 +98,83 @@ public:
      */
     int add_gate(const gate_t<FieldT> &g);
 
-    /* Clears all sum and product gates from the circuit */
+    /* Same as above, moving the gate and its input gates into the circuit */
+    int add_gate(gate_t<FieldT> &&g);
+
+    /*
+     * Reserves room for num_gates more gates, so that building a large
+     * circuit does not reallocate the gate list along the way.
+     */
+    void reserve_gates(const size_t &num_gates);
+
+    /*
+     * Marks the given gate number as an output of the circuit. Outputs are
+     * numbered in the order they are marked. A circuit with no marked
+     * outputs has a single output, its last gate.
+     */
+    void add_output(const int &gate_number);
+
+    /* Returns the gate numbers of the outputs, as described above */
+    std::vector<int> outputs() const;
+
+    /* Returns the number of outputs for the circuit */
+    size_t num_outputs() const;
+
+    /* Clears all sum and product gates, outputs, and the minimum degree, from the circuit */
     void clear_gates();
 
     /* Returns the sum of input gates, sum gates, and product gates. */
     size_t size() const;
 
-    /* Returns the largest degree computed by any particular gate. */
+    /*
+     * Returns the largest degree computed by any particular gate, or the
+     * degree set by set_min_degree() if it is larger.
+     */
     size_t degree() const;
 
+    /*
+     * Sets a lower bound on degree(), which sizes the large domain of the
+     * proofs, so that a circuit rewritten to a lower degree (see optimize())
+     * keeps the proofs of the original circuit.
+     */
+    void set_min_degree(const size_t &min_degree);
+
+    /*
+     * Returns the degree of every value of the circuit, by gate number - 1:
+     * 1 for the inputs, followed by the degree of each gate.
+     */
+    std::vector<size_t> degrees() const;
+
     /* Returns the number of inputs for the circuit */
     size_t num_inputs() const;
 
-    /* Prints circuit size, circuit degree, and number of inputs */
+    /* Returns the sum and product gates of the circuit, in insertion order */
+    const std::vector<gate_t<FieldT> > &gates() const;
+
+    /*
+     * Rewrites the circuit into an equivalent one with fewer gates, and
+     * returns the gate counts before and after. The passes are
+     *
+     * - constant folding: the constant operands of a gate are combined into
+     *   one, gates of constant operands only and products with a factor of
+     *   0 become constants, and gates left with a single operand (ex. x + 0,
+     *   x * 1) are replaced by it;
+     * - common subexpression elimination: a gate with the same type and
+     *   operands (in any order) as an earlier gate is replaced by it;
+     * - flattening: a gate read only by a gate of the same type (ex. a SUM
+     *   of a SUM) is spliced into its reader;
+     * - dead gate elimination: gates that do not feed an output are removed;
+     *
+     * repeated until flattening makes no further change. The outputs keep
+     * their values and numbering. Removing a gate of higher degree than every
+     * output, or folding a product by 0, can lower the degree of the gates,
+     * so the degree before optimizing is kept by set_min_degree(): proofs of
+     * the optimized circuit are those of the original one. Gate numbers
+     * returned by add_gate() before optimizing are no longer valid after.
+     */
+    optimization_stats_t optimize();
+
+    /* Prints circuit size, circuit degree, number of inputs and outputs */
     void print_info() const;
 
     /* 
@@ -117,7 +197,17 @@ public:
 
 private:
     const size_t _input_size;
+    size_t _min_degree;
     std::vector<gate_t<FieldT> > _gates;
+    std::vector<int> _outputs;
+
+    /* Returns the values of the inputs followed by the gate outputs */
+    std::vector<FieldT> evaluate_gates(const input_t<FieldT> &input) const;
+
+    /* Passes of optimize(), each returning its number of rewrites */
+    size_t fold_and_merge_gates(size_t &merged);
+    size_t flatten_gates();
+    size_t remove_dead_gates();
 };
 
 } // bace
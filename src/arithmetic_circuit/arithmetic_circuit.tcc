@@ -15,13 +15,37 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace bace {
 
 template<typename FieldT>
 FieldT arithmetic_circuit_t<FieldT>::evaluate(const input_t<FieldT> &input) const
+{
+    const std::vector<FieldT> gate_output = this->evaluate_gates(input);
+    return gate_output[this->outputs()[0] - 1];
+}
+
+template<typename FieldT>
+std::vector<FieldT> arithmetic_circuit_t<FieldT>::evaluate_outputs(const input_t<FieldT> &input) const
+{
+    const std::vector<FieldT> gate_output = this->evaluate_gates(input);
+
+    std::vector<FieldT> outputs;
+    for (const int &gate_number : this->outputs())
+    {
+        outputs.emplace_back(gate_output[gate_number - 1]);
+    }
+    return outputs;
+}
+
+template<typename FieldT>
+std::vector<FieldT> arithmetic_circuit_t<FieldT>::evaluate_gates(const input_t<FieldT> &input) const
 {
     assert(input.size() == this->_input_size);
     assert(this->_gates.size() > 0);
@@ -29,14 +53,17 @@ FieldT arithmetic_circuit_t<FieldT>::evaluate(const input_t<FieldT> &input) cons
     std::vector<FieldT> gate_output(input);
     gate_output.resize(this->size(), FieldT::zero());
 
+    INSTRUMENT_COUNT(COUNTER_GATES_EVALUATED, this->_gates.size());
+
     FieldT output;
     size_t i = this->_input_size;
-    for (auto gate: this->_gates)
+    size_t num_multiplications = 0;
+    for (const gate_t<FieldT> &gate : this->_gates)
     {
         if (gate.type == SUM)
         {
             output = FieldT::zero();
-            for (auto input_gate: gate.input_gates)
+            for (const input_element_t<FieldT> &input_gate : gate.input_gates)
             {
                 if (input_gate.type == CONSTANT) output += input_gate.value.constant;
                 else output += gate_output[input_gate.value.variable - 1];
@@ -47,7 +74,8 @@ FieldT arithmetic_circuit_t<FieldT>::evaluate(const input_t<FieldT> &input) cons
             if (gate.input_gates[0].type == CONSTANT) output = gate.input_gates[0].value.constant;
             else output = gate_output[gate.input_gates[0].value.variable - 1];
 
-            for (int j = 1; j < gate.input_gates.size(); j++)
+            num_multiplications += gate.input_gates.size() - 1;
+            for (size_t j = 1; j < gate.input_gates.size(); j++)
             {
                 if (gate.input_gates[j].type == CONSTANT) output *= gate.input_gates[j].value.constant;
                 else output *= gate_output[gate.input_gates[j].value.variable - 1];
@@ -55,8 +83,9 @@ FieldT arithmetic_circuit_t<FieldT>::evaluate(const input_t<FieldT> &input) cons
         }
         gate_output[i++] = output;
     }
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, num_multiplications);
 
-    return output;
+    return gate_output;
 }
 
 template<typename FieldT>
@@ -69,10 +98,49 @@ int arithmetic_circuit_t<FieldT>::add_gate(const gate_t<FieldT> &g)
     return this->size();
 }
 
+template<typename FieldT>
+int arithmetic_circuit_t<FieldT>::add_gate(gate_t<FieldT> &&g)
+{
+    assert(g.input_gates.size() > 0);
+    assert(g.type == SUM || g.type == PRODUCT);
+
+    this->_gates.emplace_back(std::move(g));
+    return this->size();
+}
+
+template<typename FieldT>
+void arithmetic_circuit_t<FieldT>::reserve_gates(const size_t &num_gates)
+{
+    this->_gates.reserve(this->_gates.size() + num_gates);
+}
+
+template<typename FieldT>
+void arithmetic_circuit_t<FieldT>::add_output(const int &gate_number)
+{
+    assert(gate_number > (int) this->_input_size && gate_number <= (int) this->size());
+
+    this->_outputs.emplace_back(gate_number);
+}
+
+template<typename FieldT>
+std::vector<int> arithmetic_circuit_t<FieldT>::outputs() const
+{
+    if (!this->_outputs.empty() || this->_gates.empty()) return this->_outputs;
+    return std::vector<int> { (int) this->size() };
+}
+
+template<typename FieldT>
+size_t arithmetic_circuit_t<FieldT>::num_outputs() const
+{
+    return this->outputs().size();
+}
+
 template<typename FieldT>
 void arithmetic_circuit_t<FieldT>::clear_gates()
 {
     this->_gates.clear();
+    this->_outputs.clear();
+    this->_min_degree = 0;
 }
 
 template<typename FieldT>
@@ -83,18 +151,32 @@ size_t arithmetic_circuit_t<FieldT>::size() const
 
 template<typename FieldT>
 size_t arithmetic_circuit_t<FieldT>::degree() const
+{
+    const std::vector<size_t> degree = this->degrees();
+    const auto gates = degree.begin() + this->_input_size;
+    const size_t gate_degree = gates == degree.end() ? 0 : *std::max_element(gates, degree.end());
+    return std::max(gate_degree, this->_min_degree);
+}
+
+template<typename FieldT>
+void arithmetic_circuit_t<FieldT>::set_min_degree(const size_t &min_degree)
+{
+    this->_min_degree = min_degree;
+}
+
+template<typename FieldT>
+std::vector<size_t> arithmetic_circuit_t<FieldT>::degrees() const
 {
     std::vector<size_t> degree(this->_input_size, 1);
     degree.resize(this->size(), 0);
 
-    size_t max_degree = 0;
     size_t i = this->_input_size;
-    for (auto gate: this->_gates)
+    for (const gate_t<FieldT> &gate : this->_gates)
     {
         size_t gate_degree = 0;
         if (gate.type == SUM)
         {
-            for (auto input_gate: gate.input_gates)
+            for (const input_element_t<FieldT> &input_gate : gate.input_gates)
             {
                 if (input_gate.type == VARIABLE)
                 {
@@ -104,7 +186,7 @@ size_t arithmetic_circuit_t<FieldT>::degree() const
         }
         else if (gate.type == PRODUCT)
         {
-            for (auto input_gate: gate.input_gates)
+            for (const input_element_t<FieldT> &input_gate : gate.input_gates)
             {
                 if (input_gate.type == VARIABLE)
                 {
@@ -114,10 +196,9 @@ size_t arithmetic_circuit_t<FieldT>::degree() const
         }
 
         degree[i++] = gate_degree;
-        max_degree = std::max(max_degree, gate_degree);
     }
 
-    return max_degree;
+    return degree;
 }
 
 template<typename FieldT>
@@ -126,12 +207,249 @@ size_t arithmetic_circuit_t<FieldT>::num_inputs() const
     return this->_input_size;
 }
 
+template<typename FieldT>
+const std::vector<gate_t<FieldT> > &arithmetic_circuit_t<FieldT>::gates() const
+{
+    return this->_gates;
+}
+
+template<typename FieldT>
+optimization_stats_t arithmetic_circuit_t<FieldT>::optimize()
+{
+    optimization_stats_t stats = { this->_gates.size(), 0, 0, 0, 0, 0 };
+    const bool default_output = this->_outputs.empty();
+    if (this->_gates.empty()) return stats;
+
+    /* Outputs are made explicit, as the last gate may change */
+    this->_outputs = this->outputs();
+    this->set_min_degree(this->degree());
+
+    size_t flattened;
+    do
+    {
+        stats.folded += this->fold_and_merge_gates(stats.merged);
+        stats.removed += this->remove_dead_gates();
+        flattened = this->flatten_gates();
+        stats.flattened += flattened;
+    } while (flattened > 0);
+
+    if (default_output && this->_outputs[0] == (int) this->size()) this->_outputs.clear();
+
+    stats.gates_after = this->_gates.size();
+    return stats;
+}
+
+/* Returns a key identifying the type and operands of a gate with sorted operands */
+template<typename FieldT>
+std::string get_gate_key(const gate_t<FieldT> &gate)
+{
+    std::string key(1, gate.type == SUM ? '+' : '*');
+    for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+    {
+        if (input_gate.type == VARIABLE)
+        {
+            key += 'v';
+            key.append(reinterpret_cast<const char*>(&input_gate.value.variable), sizeof(int));
+        }
+        else
+        {
+            key += 'c';
+            key.append(reinterpret_cast<const char*>(&input_gate.value.constant), sizeof(FieldT));
+        }
+    }
+    return key;
+}
+
+template<typename FieldT>
+size_t arithmetic_circuit_t<FieldT>::fold_and_merge_gates(size_t &merged)
+{
+    const int input_size = this->_input_size;
+    size_t folded = 0;
+
+    /* What each value of the circuit is replaced by, a constant or a variable of the new gates */
+    const input_element_t<FieldT> unset = { CONSTANT, { 0 } };
+    std::vector<input_element_t<FieldT> > value(this->size() + 1, unset);
+    for (int i = 1; i <= input_size; i++) value[i] = { VARIABLE, i };
+
+    std::vector<gate_t<FieldT> > gates;
+    std::unordered_map<std::string, int> gate_numbers;
+    for (size_t g = 0; g < this->_gates.size(); g++)
+    {
+        const gate_t<FieldT> &old_gate = this->_gates[g];
+        gate_t<FieldT> gate = { old_gate.type, std::vector<input_element_t<FieldT> >() };
+
+        bool has_constant = false;
+        FieldT constant = (gate.type == SUM) ? FieldT::zero() : FieldT::one();
+        for (const input_element_t<FieldT> &input_gate : old_gate.input_gates)
+        {
+            const input_element_t<FieldT> &element =
+                (input_gate.type == CONSTANT) ? input_gate : value[input_gate.value.variable];
+            if (element.type == VARIABLE)
+            {
+                gate.input_gates.emplace_back(element);
+            }
+            else
+            {
+                if (gate.type == SUM) constant += element.value.constant;
+                else constant *= element.value.constant;
+                has_constant = true;
+            }
+        }
+
+        /* Operands are commutative, so sorting them makes identical gates compare equal */
+        std::sort(gate.input_gates.begin(), gate.input_gates.end(),
+                  [](const input_element_t<FieldT> &a, const input_element_t<FieldT> &b)
+                  { return a.value.variable < b.value.variable; });
+
+        /* A product by 0 is 0, whatever its other operands */
+        if (gate.type == PRODUCT && has_constant && constant == FieldT::zero()) gate.input_gates.clear();
+
+        const FieldT identity = (gate.type == SUM) ? FieldT::zero() : FieldT::one();
+        if (has_constant && !(constant == identity && !gate.input_gates.empty()))
+        {
+            input_element_t<FieldT> element = { CONSTANT, { 0 } };
+            element.value.constant = constant;
+            gate.input_gates.emplace_back(element);
+        }
+
+        const size_t number = input_size + g + 1;
+        if (gate.input_gates.empty() || (gate.input_gates.size() == 1 && gate.input_gates[0].type == CONSTANT))
+        {
+            value[number] = { CONSTANT, { 0 } };
+            value[number].value.constant = constant;
+            folded++;
+        }
+        else if (gate.input_gates.size() == 1)
+        {
+            value[number] = gate.input_gates[0];
+            folded++;
+        }
+        else
+        {
+            const std::string key = get_gate_key(gate);
+            const auto it = gate_numbers.find(key);
+            if (it != gate_numbers.end())
+            {
+                value[number] = { VARIABLE, it->second };
+                merged++;
+            }
+            else
+            {
+                gates.emplace_back(gate);
+                gate_numbers.emplace(key, input_size + (int) gates.size());
+                value[number] = { VARIABLE, input_size + (int) gates.size() };
+            }
+        }
+    }
+
+    /* An output replaced by an input or a constant is kept as a gate of its own */
+    for (int &output : this->_outputs)
+    {
+        const input_element_t<FieldT> &element = value[output];
+        if (element.type == VARIABLE && element.value.variable > input_size)
+        {
+            output = element.value.variable;
+        }
+        else
+        {
+            gates.emplace_back(gate_t<FieldT> { SUM, std::vector<input_element_t<FieldT> > { element } });
+            output = input_size + gates.size();
+        }
+    }
+
+    this->_gates = gates;
+    return folded;
+}
+
+template<typename FieldT>
+size_t arithmetic_circuit_t<FieldT>::flatten_gates()
+{
+    const size_t input_size = this->_input_size;
+    size_t flattened = 0;
+
+    /* Outputs count as a reader, so they are never spliced away */
+    std::vector<size_t> num_readers(this->size() + 1, 0);
+    for (const gate_t<FieldT> &gate : this->_gates)
+    {
+        for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            if (input_gate.type == VARIABLE) num_readers[input_gate.value.variable]++;
+        }
+    }
+    for (const int &output : this->_outputs) num_readers[output]++;
+
+    /* Gates are in topological order, so spliced operands are already flattened */
+    for (gate_t<FieldT> &gate : this->_gates)
+    {
+        std::vector<input_element_t<FieldT> > input_gates;
+        for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            const int variable = input_gate.value.variable;
+            if (input_gate.type == VARIABLE && variable > (int) input_size &&
+                num_readers[variable] == 1 && this->_gates[variable - input_size - 1].type == gate.type)
+            {
+                const gate_t<FieldT> &spliced = this->_gates[variable - input_size - 1];
+                input_gates.insert(input_gates.end(), spliced.input_gates.begin(), spliced.input_gates.end());
+                flattened++;
+            }
+            else
+            {
+                input_gates.emplace_back(input_gate);
+            }
+        }
+        gate.input_gates = input_gates;
+    }
+
+    return flattened;
+}
+
+template<typename FieldT>
+size_t arithmetic_circuit_t<FieldT>::remove_dead_gates()
+{
+    const size_t input_size = this->_input_size;
+
+    std::vector<bool> live(this->size() + 1, false);
+    for (const int &output : this->_outputs) live[output] = true;
+    for (size_t g = this->_gates.size(); g-- > 0;)
+    {
+        if (!live[input_size + g + 1]) continue;
+        for (const input_element_t<FieldT> &input_gate : this->_gates[g].input_gates)
+        {
+            if (input_gate.type == VARIABLE) live[input_gate.value.variable] = true;
+        }
+    }
+
+    /* Live gates keep their order, and are renumbered */
+    std::vector<int> number(this->size() + 1);
+    for (size_t i = 1; i <= input_size; i++) number[i] = i;
+
+    std::vector<gate_t<FieldT> > gates;
+    for (size_t g = 0; g < this->_gates.size(); g++)
+    {
+        if (!live[input_size + g + 1]) continue;
+
+        gate_t<FieldT> gate = this->_gates[g];
+        for (input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            if (input_gate.type == VARIABLE) input_gate.value.variable = number[input_gate.value.variable];
+        }
+        gates.emplace_back(gate);
+        number[input_size + g + 1] = input_size + gates.size();
+    }
+    for (int &output : this->_outputs) output = number[output];
+
+    const size_t removed = this->_gates.size() - gates.size();
+    this->_gates = gates;
+    return removed;
+}
+
 template<typename FieldT>
 void arithmetic_circuit_t<FieldT>::print_info() const
 {
     printf("* Circuit size: %zu\n", this->size());
     printf("* Circuit degree: %zu\n", this->degree());
     printf("* Number of inputs: %zu\n", this->num_inputs());
+    printf("* Number of outputs: %zu\n", this->num_outputs());
 }
 
 template<typename FieldT>
@@ -140,22 +458,25 @@ void arithmetic_circuit_t<FieldT>::add_inner_product_gates()
     const bool odd = this->_input_size % 2 == 1;
     const int mid = odd ? (this->_input_size / 2) + 1 : this->_input_size / 2;
 
+    /* Gates are built in place and moved in, with the gate list reserved up front */
+    this->reserve_gates(mid + 1);
     std::vector<input_element_t<FieldT> > input_gates;
+    input_gates.reserve(mid);
     for (int i = 1; i <= mid; i++)
     {
         if (i == mid - 1 && odd) continue;
 
         const input_element_t<FieldT> left = { VARIABLE, i };
         const input_element_t<FieldT> right = { VARIABLE, mid + i };
-        const gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { left, right } };
-        const int gate_number = this->add_gate(product_gate);
+        gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { left, right } };
+        const int gate_number = this->add_gate(std::move(product_gate));
 
         const input_element_t<FieldT> element = { VARIABLE, gate_number };
         input_gates.emplace_back(element);
     }
 
-    const gate_t<FieldT> sum_gate = { SUM, input_gates };
-    this->add_gate(sum_gate);
+    gate_t<FieldT> sum_gate = { SUM, std::move(input_gates) };
+    this->add_gate(std::move(sum_gate));
 }
 
 template<typename FieldT>
@@ -164,45 +485,50 @@ void arithmetic_circuit_t<FieldT>::add_quadratic_inner_product_gates()
     const bool odd = this->_input_size % 2 == 1;
     const int mid = odd ? (this->_input_size / 2) + 1 : this->_input_size / 2;
 
+    /* Gates are built in place and moved in, with the gate list reserved up front */
+    this->reserve_gates(mid * (mid + 1) + mid + 1);
     std::vector<input_element_t<FieldT> > product_input_gates;
+    product_input_gates.reserve(mid);
     for (int i = 0; i < mid; i++)
     {
         std::vector<input_element_t<FieldT> > input_gates;
+        input_gates.reserve(mid);
         for (int j = 1; j <= mid; j++)
         {
             if (j == mid - 1 && odd) continue;
 
             const input_element_t<FieldT> left = { VARIABLE, j };
             const input_element_t<FieldT> right = { VARIABLE, j };
-            const gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { left, right } };
-            const int gate_number = this->add_gate(product_gate);
+            gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { left, right } };
+            const int gate_number = this->add_gate(std::move(product_gate));
 
             const input_element_t<FieldT> element = { VARIABLE, gate_number };
             input_gates.emplace_back(element);
         }
 
-        const gate_t<FieldT> sum_gate = { SUM, input_gates };
-        const int gate_number = this->add_gate(sum_gate);
+        gate_t<FieldT> sum_gate = { SUM, std::move(input_gates) };
+        const int gate_number = this->add_gate(std::move(sum_gate));
 
         const input_element_t<FieldT> element = { VARIABLE, gate_number };
         product_input_gates.emplace_back(element);
     }
-    
+
     std::vector<input_element_t<FieldT> > input_gates;
+    input_gates.reserve(mid);
     for (int i = 1; i <= mid; i++)
     {
         if (i == mid - 1 && odd) continue;
 
         const input_element_t<FieldT> right = { VARIABLE, mid + i };
-        const gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { product_input_gates[i-1], right } };
-        const int gate_number = this->add_gate(product_gate);
+        gate_t<FieldT> product_gate = { PRODUCT, std::vector<input_element_t<FieldT> > { product_input_gates[i-1], right } };
+        const int gate_number = this->add_gate(std::move(product_gate));
 
         const input_element_t<FieldT> element = { VARIABLE, gate_number };
         input_gates.emplace_back(element);
     }
 
-    const gate_t<FieldT> sum_gate = { SUM, input_gates };
-    this->add_gate(sum_gate);
+    gate_t<FieldT> sum_gate = { SUM, std::move(input_gates) };
+    this->add_gate(std::move(sum_gate));
 }
 
 } // bace
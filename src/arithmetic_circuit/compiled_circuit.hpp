@@ -0,0 +1,262 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for compiled arithmetic circuit.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef COMPILED_CIRCUIT_HPP_
+#define COMPILED_CIRCUIT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/common/binary_format.hpp"
+
+namespace bace {
+
+/*
+ * Number of points evaluated together by evaluate_batch() in the proof
+ * system. Larger blocks amortize the walk over the gate list further,
+ * at the cost of num_slots() * block_size field elements of scratch.
+ */
+const size_t DEFAULT_BLOCK_SIZE = 64;
+
+/*
+ * Thresholds of level-parallel evaluation (see evaluate_levels()): levels of
+ * at least LEVEL_MIN_WIDTH gates are split across threads, and gates of at
+ * least REDUCTION_MIN_FAN_IN operands are reduced by all threads together.
+ * The operands of these gates are the parallel work of an evaluation, and a
+ * circuit is evaluated level by level, for up to LEVEL_MAX_POINTS points,
+ * when it has at least LEVEL_MIN_OPERANDS of them, making up at least
+ * LEVEL_MIN_PARALLEL_PERCENT percent of its operands. A deep and narrow
+ * circuit, which would pay a barrier per level for little parallel work,
+ * is evaluated sequentially whatever its size.
+ */
+const size_t LEVEL_MIN_OPERANDS = 1 << 15;
+const size_t LEVEL_MIN_PARALLEL_PERCENT = 50;
+const size_t LEVEL_MAX_POINTS = 8;
+const size_t LEVEL_MIN_WIDTH = 256;
+const size_t REDUCTION_MIN_FAN_IN = 4096;
+
+/*********************** COMPILED ARITHMETIC CIRCUIT *************************/
+
+/*
+ * Counts of the gate table of a circuit file, whose serialization_header_t
+ * holds the number of inputs (input_size), the degree, and the number of
+ * constants (num_elements). The checksum of a circuit file covers this
+ * header, the constants and the gate table, so none of them can change
+ * unnoticed.
+ */
+struct circuit_header_t
+{
+    uint64_t num_gates;
+    uint64_t num_operands;
+    uint64_t num_outputs;
+    uint64_t reserved[5];
+};
+
+/*
+ * A compiled circuit is a flat execution plan for an arithmetic_circuit_t,
+ * meant for circuits that are evaluated many times (ex. once per point of
+ * the large domain in the prover).
+ *
+ * Gates are stored as a structure of arrays: one opcode per gate, and a CSR
+ * (compressed sparse row) operand array, such that the operands of gate g are
+ * operands[offsets[g]], ... , operands[offsets[g + 1] - 1]. Every operand is
+ * an index into a single value buffer, which is laid out as
+ *
+ * [ inputs (num_inputs) | gate outputs (num_gates) | constants (num_constants) ]
+ *
+ * so constant and variable operands are read alike, without branching on
+ * the input type. The value buffer is the scratch buffer of the evaluation;
+ * it is obtained once from get_scratch(), with the constant pool preloaded,
+ * and can then be reused across evaluations without any heap allocation.
+ *
+ * For evaluation over many points, evaluate_batch() applies each gate to a
+ * whole block of points before moving to the next gate. Its scratch buffer
+ * holds one row of block_size values per slot, where slots are assigned at
+ * compile time by liveness: a gate output takes over the row of a value
+ * that is no longer read, so the scratch only grows with the number of
+ * values live at once, rather than with the size of the circuit.
+ *
+ * The gate table and the constant pool can be written to a circuit file
+ * (see binary_format.hpp), laid out after the header as
+ *
+ * [ constants | circuit_header_t | offsets (uint64) | types | operands | outputs (uint32) ]
+ *
+ * with gates in topological order, and operands indexing the value buffer
+ * as above. Loading a circuit file maps it and copies each table in one
+ * piece, so no gate_t is ever built for it.
+ *
+ * Gates are also grouped into dependency levels at compile time, a gate's
+ * level being one more than the highest level among its operands, so that
+ * the gates of a level only read values of earlier levels. A single point
+ * evaluation of a large circuit runs level by level, in parallel across
+ * the gates of wide levels (see evaluate_levels()).
+ */
+template<typename FieldT>
+class compiled_circuit_t {
+public:
+    compiled_circuit_t(const arithmetic_circuit_t<FieldT> &circuit);
+
+    /*
+     * Loads a circuit file written by write(), throwing std::runtime_error if
+     * it is not a valid circuit file for FieldT.
+     */
+    compiled_circuit_t(const std::string &path);
+
+    /* Writes the circuit to path, as a circuit file */
+    void write(const std::string &path) const;
+
+    /*
+     * Returns the equivalent arithmetic_circuit_t, with the outputs marked
+     * explicitly, for the interfaces that take one (ex. prover()).
+     */
+    arithmetic_circuit_t<FieldT> to_circuit() const;
+
+    /* Returns a scratch buffer for evaluate(), with the constant pool preloaded. */
+    std::vector<FieldT> get_scratch() const;
+
+    /*
+     * Returns the evaluation of the circuit's first output on the input held
+     * in the first num_inputs() entries of scratch, which must come from
+     * get_scratch(). The gate outputs are written to scratch. If the circuit
+     * contains no gates, the evaluation will return 0.
+     */
+    FieldT evaluate(std::vector<FieldT> &scratch) const;
+
+    /* Copies the input into scratch, then evaluates as above. */
+    FieldT evaluate(const input_t<FieldT> &input, std::vector<FieldT> &scratch) const;
+
+    /*
+     * Writes the gate outputs to scratch as evaluate() does, one level at a
+     * time: the gates of a level of at least LEVEL_MIN_WIDTH gates are split
+     * across threads, and a gate of at least REDUCTION_MIN_FAN_IN operands is
+     * reduced in parallel. Under MULTICORE, evaluate() and evaluate_outputs()
+     * use it for level-parallel circuits (see is_level_parallel()), when not
+     * already called from a parallel region.
+     */
+    void evaluate_levels(std::vector<FieldT> &scratch) const;
+
+    /*
+     * Copies the input into scratch, and returns the evaluations of all
+     * outputs of the circuit, in order.
+     */
+    std::vector<FieldT> evaluate_outputs(const input_t<FieldT> &input, std::vector<FieldT> &scratch) const;
+
+    /*
+     * Returns a scratch buffer for evaluate_batch() on blocks of up to
+     * block_size points, with the constant pool preloaded.
+     */
+    std::vector<FieldT> get_batch_scratch(const size_t &block_size) const;
+
+    /*
+     * Evaluates the circuit on num_points <= block_size points at once, and
+     * writes the evaluations to output[0], ... , output[num_points - 1].
+     *
+     * The scratch buffer must come from get_batch_scratch(block_size). It is
+     * gate-major and point-minor: before the call, the j-th input of point p
+     * is expected at scratch[j * block_size + p], which makes each input a
+     * contiguous row that can be copied in directly from a column. The input
+     * rows are overwritten by the evaluation.
+     */
+    void evaluate_batch(std::vector<FieldT> &scratch,
+                        const size_t &block_size,
+                        const size_t &num_points,
+                        FieldT *output) const;
+
+    /*
+     * Same as above, for all outputs of the circuit: the evaluation of
+     * output k at point p is written to output[k * block_size + p].
+     */
+    void evaluate_batch_outputs(std::vector<FieldT> &scratch,
+                                const size_t &block_size,
+                                const size_t &num_points,
+                                FieldT *output) const;
+
+    /*
+     * Returns the evaluations of every output at each of the given inputs,
+     * such that result[k][p] is output k at inputs[p]. The inputs are
+     * evaluated together, as one block of evaluate_batch_outputs(), unless
+     * there are few enough of them to go through evaluate_levels(). As for
+     * evaluate(), a circuit with no gates has a single output, 0.
+     */
+    std::vector<std::vector<FieldT> > evaluate_outputs(const std::vector<input_t<FieldT> > &inputs) const;
+
+    /* Returns the number of inputs for the circuit */
+    size_t num_inputs() const;
+
+    /* Returns the number of outputs of the circuit */
+    size_t num_outputs() const;
+
+    /* Returns the number of sum and product gates */
+    size_t num_gates() const;
+
+    /* Returns the number of field multiplications of one evaluation */
+    size_t num_multiplications() const;
+
+    /* Returns the number of constants in the constant pool */
+    size_t num_constants() const;
+
+    /* Returns the number of scratch rows used by evaluate_batch() */
+    size_t num_slots() const;
+
+    /* Returns the degree of the circuit, as computed at compile time */
+    size_t degree() const;
+
+    /* Returns the number of dependency levels of the gates */
+    size_t num_levels() const;
+
+    /*
+     * Returns whether enough of the work of an evaluation lies in wide levels
+     * and large reductions for evaluate_levels() to pay off
+     */
+    bool is_level_parallel() const;
+
+private:
+    size_t _input_size;
+    size_t _degree;
+    size_t _num_multiplications;
+    std::vector<gate_type_t> _types;
+    std::vector<size_t> _offsets;
+    std::vector<uint32_t> _operands;
+    std::vector<FieldT> _constants;
+    std::vector<uint32_t> _outputs;
+
+    /* Slot-allocated plan for evaluate_batch() */
+    size_t _num_slots;
+    std::vector<uint32_t> _batch_operands;
+    std::vector<uint32_t> _batch_targets;
+    std::vector<uint32_t> _batch_outputs;
+
+    /* Gates grouped by level: level l is _level_gates[_level_offsets[l]], ... */
+    std::vector<size_t> _level_offsets;
+    std::vector<uint32_t> _level_gates;
+    bool _level_parallel;
+
+    void allocate_slots();
+    void allocate_levels();
+
+    /* Returns the output of gate i, given the value buffer */
+    FieldT evaluate_gate(const FieldT *values, const size_t &i) const;
+
+    /* Returns whether to evaluate single points level by level */
+    bool use_levels() const;
+
+    /* Applies the gates of the batch plan to the rows of scratch */
+    void evaluate_rows(std::vector<FieldT> &scratch,
+                       const size_t &block_size,
+                       const size_t &num_points) const;
+};
+
+} // bace
+
+#include "compiled_circuit.tcc"
+
+#endif // COMPILED_CIRCUIT_HPP_
@@ -0,0 +1,707 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for compiled arithmetic circuit.
+
+ See compiled_circuit.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef COMPILED_CIRCUIT_TCC_
+#define COMPILED_CIRCUIT_TCC_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace bace {
+
+template<typename FieldT>
+compiled_circuit_t<FieldT>::compiled_circuit_t(const arithmetic_circuit_t<FieldT> &circuit) :
+    _input_size(circuit.num_inputs()), _degree(circuit.degree()), _num_multiplications(0)
+{
+    const std::vector<gate_t<FieldT> > &gates = circuit.gates();
+    const size_t constant_offset = circuit.size();
+
+    size_t num_operands = 0;
+    for (const gate_t<FieldT> &gate : gates)
+    {
+        num_operands += gate.input_gates.size();
+    }
+
+    this->_types.reserve(gates.size());
+    this->_offsets.reserve(gates.size() + 1);
+    this->_operands.reserve(num_operands);
+
+    this->_offsets.emplace_back(0);
+    for (const gate_t<FieldT> &gate : gates)
+    {
+        for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            if (input_gate.type == CONSTANT)
+            {
+                this->_operands.emplace_back(constant_offset + this->_constants.size());
+                this->_constants.emplace_back(input_gate.value.constant);
+            }
+            else
+            {
+                assert(input_gate.value.variable >= 1);
+                this->_operands.emplace_back(input_gate.value.variable - 1);
+            }
+        }
+        this->_types.emplace_back(gate.type);
+        this->_offsets.emplace_back(this->_operands.size());
+        if (gate.type == PRODUCT) this->_num_multiplications += gate.input_gates.size() - 1;
+    }
+
+    for (const int &gate_number : circuit.outputs())
+    {
+        this->_outputs.emplace_back(gate_number - 1);
+    }
+
+    this->allocate_slots();
+    this->allocate_levels();
+}
+
+/* Offsets in bytes of the tables of a circuit file, after its serialization_header_t */
+struct circuit_layout_t
+{
+    size_t circuit_header;
+    size_t offsets;
+    size_t types;
+    size_t operands;
+    size_t outputs;
+    size_t end;
+};
+
+template<typename FieldT>
+circuit_layout_t get_circuit_layout(const size_t &num_constants, const circuit_header_t &counts)
+{
+    const auto padded = [](const size_t &size) { return (size + 7) / 8 * 8; };
+    circuit_layout_t layout;
+    layout.circuit_header = sizeof(serialization_header_t) + padded(num_constants * sizeof(FieldT));
+    layout.offsets = layout.circuit_header + sizeof(circuit_header_t);
+    layout.types = layout.offsets + (counts.num_gates + 1) * sizeof(uint64_t);
+    layout.operands = layout.types + padded(counts.num_gates * sizeof(uint32_t));
+    layout.outputs = layout.operands + padded(counts.num_operands * sizeof(uint32_t));
+    layout.end = layout.outputs + padded(counts.num_outputs * sizeof(uint32_t));
+    return layout;
+}
+
+template<typename FieldT>
+compiled_circuit_t<FieldT>::compiled_circuit_t(const std::string &path) : _num_multiplications(0)
+{
+    const mapped_file_t file(path);
+    const serialization_header_t header = read_header<FieldT>(file, SERIALIZED_CIRCUIT, path);
+    const char *data = file.data();
+
+    circuit_header_t counts;
+    circuit_layout_t layout = get_circuit_layout<FieldT>(header.num_elements, circuit_header_t());
+    if (file.size() < layout.offsets) throw std::runtime_error("compiled_circuit_t: truncated circuit in " + path);
+    memcpy(&counts, data + layout.circuit_header, sizeof(counts));
+    if (counts.num_gates >= UINT32_MAX || counts.num_operands >= UINT32_MAX || counts.num_outputs >= UINT32_MAX)
+    {
+        throw std::runtime_error("compiled_circuit_t: inconsistent header in " + path);
+    }
+    layout = get_circuit_layout<FieldT>(header.num_elements, counts);
+    if (file.size() < layout.end) throw std::runtime_error("compiled_circuit_t: truncated circuit in " + path);
+
+    const size_t end = layout.end - sizeof(serialization_header_t);
+    if (get_checksum(data + sizeof(serialization_header_t), end, get_header_checksum(header)) != header.checksum)
+    {
+        throw std::runtime_error("compiled_circuit_t: checksum mismatch in " + path);
+    }
+
+    /* One bulk copy per table */
+    const FieldT *constants = reinterpret_cast<const FieldT*>(data + sizeof(serialization_header_t));
+    const uint64_t *offsets = reinterpret_cast<const uint64_t*>(data + layout.offsets);
+    const uint32_t *types = reinterpret_cast<const uint32_t*>(data + layout.types);
+    const uint32_t *operands = reinterpret_cast<const uint32_t*>(data + layout.operands);
+    const uint32_t *outputs = reinterpret_cast<const uint32_t*>(data + layout.outputs);
+    this->_input_size = header.input_size;
+    this->_degree = header.degree;
+    this->_constants.assign(constants, constants + header.num_elements);
+    this->_offsets.assign(offsets, offsets + counts.num_gates + 1);
+    this->_operands.assign(operands, operands + counts.num_operands);
+    this->_outputs.assign(outputs, outputs + counts.num_outputs);
+    this->_types.resize(counts.num_gates);
+
+    /* Gates must be in topological order, reading only inputs, earlier gates and constants */
+    const size_t constant_offset = this->_input_size + counts.num_gates;
+    const size_t num_values = constant_offset + this->_constants.size();
+    bool valid = this->_offsets[0] == 0 && this->_offsets[counts.num_gates] == counts.num_operands;
+    for (size_t i = 0; i < counts.num_gates && valid; i++)
+    {
+        valid = (types[i] == SUM || types[i] == PRODUCT) && this->_offsets[i] < this->_offsets[i + 1];
+        for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1] && valid; k++)
+        {
+            const uint32_t operand = this->_operands[k];
+            valid = operand < this->_input_size + i || (operand >= constant_offset && operand < num_values);
+        }
+        if (!valid) break;
+
+        this->_types[i] = gate_type_t(types[i]);
+        if (types[i] == PRODUCT) this->_num_multiplications += this->_offsets[i + 1] - this->_offsets[i] - 1;
+    }
+    for (const uint32_t &output : this->_outputs)
+    {
+        valid = valid && output >= this->_input_size && output < constant_offset;
+    }
+    if (!valid) throw std::runtime_error("compiled_circuit_t: invalid gate table in " + path);
+
+    this->allocate_slots();
+    this->allocate_levels();
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::write(const std::string &path) const
+{
+    circuit_header_t counts;
+    memset(&counts, 0, sizeof(counts));
+    counts.num_gates = this->num_gates();
+    counts.num_operands = this->_operands.size();
+    counts.num_outputs = this->_outputs.size();
+    const circuit_layout_t layout = get_circuit_layout<FieldT>(this->num_constants(), counts);
+
+    /* The file is assembled in memory, then checksummed and written at once */
+    std::vector<char> buffer(layout.end, 0);
+    char *data = buffer.data();
+    std::vector<uint64_t> offsets(this->_offsets.begin(), this->_offsets.end());
+    std::vector<uint32_t> types(this->_types.begin(), this->_types.end());
+    memcpy(data + sizeof(serialization_header_t), this->_constants.data(), this->num_constants() * sizeof(FieldT));
+    memcpy(data + layout.circuit_header, &counts, sizeof(counts));
+    memcpy(data + layout.offsets, offsets.data(), offsets.size() * sizeof(uint64_t));
+    memcpy(data + layout.types, types.data(), types.size() * sizeof(uint32_t));
+    memcpy(data + layout.operands, this->_operands.data(), this->_operands.size() * sizeof(uint32_t));
+    memcpy(data + layout.outputs, this->_outputs.data(), this->_outputs.size() * sizeof(uint32_t));
+
+    serialization_header_t header = get_header<FieldT>(SERIALIZED_CIRCUIT);
+    header.input_size = this->_input_size;
+    header.degree = this->_degree;
+    header.num_elements = this->num_constants();
+    header.checksum = get_checksum(data + sizeof(header), layout.end - sizeof(header), get_header_checksum(header));
+    memcpy(data, &header, sizeof(header));
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) throw std::runtime_error("compiled_circuit_t: cannot open " + path);
+
+    const bool ok = fwrite(data, 1, buffer.size(), file) == buffer.size();
+    if (fclose(file) != 0 || !ok) throw std::runtime_error("compiled_circuit_t: cannot write " + path);
+}
+
+template<typename FieldT>
+arithmetic_circuit_t<FieldT> compiled_circuit_t<FieldT>::to_circuit() const
+{
+    const size_t num_gates = this->num_gates();
+    const size_t constant_offset = this->_input_size + num_gates;
+
+    arithmetic_circuit_t<FieldT> circuit(this->_input_size);
+    circuit.reserve_gates(num_gates);
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        gate_t<FieldT> gate = { this->_types[i], std::vector<input_element_t<FieldT> >() };
+        gate.input_gates.reserve(this->_offsets[i + 1] - this->_offsets[i]);
+        for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1]; k++)
+        {
+            const uint32_t operand = this->_operands[k];
+            input_element_t<FieldT> element = { VARIABLE, { (int) operand + 1 } };
+            if (operand >= constant_offset)
+            {
+                element.type = CONSTANT;
+                element.value.constant = this->_constants[operand - constant_offset];
+            }
+            gate.input_gates.emplace_back(element);
+        }
+        circuit.add_gate(std::move(gate));
+    }
+
+    for (const uint32_t &output : this->_outputs)
+    {
+        circuit.add_output(output + 1);
+    }
+    circuit.set_min_degree(this->_degree);
+    return circuit;
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::allocate_slots()
+{
+    const size_t num_gates = this->num_gates();
+    const size_t gate_offset = this->_input_size;
+    const size_t constant_offset = this->_input_size + num_gates;
+    const size_t num_values = constant_offset + this->num_constants();
+
+    /* Index of the last gate reading each value (a gate is its own last reader if unused) */
+    std::vector<size_t> last_use(num_values, 0);
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        last_use[gate_offset + i] = i;
+        for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1]; k++)
+        {
+            last_use[this->_operands[k]] = i;
+        }
+    }
+    for (const uint32_t &output : this->_outputs) last_use[output] = num_gates; // Outputs are never freed
+
+    /* Inputs and constants are pinned to the leading slots */
+    std::vector<uint32_t> slot(num_values);
+    for (size_t i = 0; i < gate_offset; i++) slot[i] = i;
+    for (size_t i = constant_offset; i < num_values; i++) slot[i] = gate_offset + (i - constant_offset);
+    this->_num_slots = gate_offset + this->num_constants();
+
+    std::vector<uint32_t> free_slots;
+    std::vector<bool> freed(num_values, false);
+    this->_batch_operands.resize(this->_operands.size());
+    this->_batch_targets.resize(num_gates);
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        /* Allocate the target before releasing operands, so a gate never writes a row it reads */
+        uint32_t target;
+        if (free_slots.empty())
+        {
+            target = this->_num_slots++;
+        }
+        else
+        {
+            target = free_slots.back();
+            free_slots.pop_back();
+        }
+        slot[gate_offset + i] = target;
+        this->_batch_targets[i] = target;
+
+        for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1]; k++)
+        {
+            const uint32_t operand = this->_operands[k];
+            this->_batch_operands[k] = slot[operand];
+            if (operand < constant_offset && last_use[operand] == i && !freed[operand])
+            {
+                free_slots.emplace_back(slot[operand]);
+                freed[operand] = true;
+            }
+        }
+        if (last_use[gate_offset + i] == i) free_slots.emplace_back(target);
+    }
+
+    this->_batch_outputs.clear();
+    for (const uint32_t &output : this->_outputs)
+    {
+        this->_batch_outputs.emplace_back(slot[output]);
+    }
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::allocate_levels()
+{
+    const size_t num_gates = this->num_gates();
+
+    /* Inputs and constants are at level 0, gates from level 1 */
+    std::vector<uint32_t> level(num_gates, 0);
+    size_t num_levels = 0;
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        uint32_t operand_level = 0;
+        for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1]; k++)
+        {
+            const uint32_t operand = this->_operands[k];
+            if (operand >= this->_input_size && operand < this->_input_size + num_gates)
+            {
+                operand_level = std::max(operand_level, level[operand - this->_input_size]);
+            }
+        }
+        level[i] = operand_level + 1;
+        num_levels = std::max<size_t>(num_levels, level[i]);
+    }
+
+    /* Counting sort of the gates by level, keeping their order within a level */
+    this->_level_offsets.assign(num_levels + 1, 0);
+    for (size_t i = 0; i < num_gates; i++) this->_level_offsets[level[i]]++;
+    for (size_t l = 1; l <= num_levels; l++) this->_level_offsets[l] += this->_level_offsets[l - 1];
+
+    this->_level_gates.resize(num_gates);
+    std::vector<size_t> next(this->_level_offsets.begin(), this->_level_offsets.end() - 1);
+    for (size_t i = 0; i < num_gates; i++) this->_level_gates[next[level[i] - 1]++] = i;
+
+    /* The operands that evaluate_levels() splits across threads */
+    size_t num_parallel_operands = 0;
+    for (size_t l = 0; l < num_levels; l++)
+    {
+        const bool wide = this->_level_offsets[l + 1] - this->_level_offsets[l] >= LEVEL_MIN_WIDTH;
+        for (size_t g = this->_level_offsets[l]; g < this->_level_offsets[l + 1]; g++)
+        {
+            const size_t i = this->_level_gates[g];
+            const size_t fan_in = this->_offsets[i + 1] - this->_offsets[i];
+            if (wide || fan_in >= REDUCTION_MIN_FAN_IN) num_parallel_operands += fan_in;
+        }
+    }
+    this->_level_parallel = num_parallel_operands >= LEVEL_MIN_OPERANDS &&
+        100 * num_parallel_operands >= LEVEL_MIN_PARALLEL_PERCENT * this->_operands.size();
+}
+
+template<typename FieldT>
+FieldT compiled_circuit_t<FieldT>::evaluate_gate(const FieldT *values, const size_t &i) const
+{
+    const uint32_t *operand = this->_operands.data() + this->_offsets[i];
+    const uint32_t *end = this->_operands.data() + this->_offsets[i + 1];
+
+    FieldT result = values[*operand++];
+    if (this->_types[i] == SUM)
+    {
+        for (; operand != end; operand++) result += values[*operand];
+    }
+    else
+    {
+        for (; operand != end; operand++) result *= values[*operand];
+    }
+    return result;
+}
+
+template<typename FieldT>
+bool compiled_circuit_t<FieldT>::use_levels() const
+{
+#ifdef MULTICORE
+    return this->_level_parallel && !omp_in_parallel() && omp_get_max_threads() > 1;
+#else
+    return false;
+#endif
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::evaluate_levels(std::vector<FieldT> &scratch) const
+{
+    assert(scratch.size() == this->_input_size + this->num_gates() + this->num_constants());
+
+    FieldT *values = scratch.data();
+    FieldT *output = values + this->_input_size;
+    const size_t num_levels = this->num_levels();
+#ifdef MULTICORE
+    std::vector<FieldT> partial(omp_get_max_threads(), FieldT::zero());
+    #pragma omp parallel
+#else
+    std::vector<FieldT> partial(1, FieldT::zero());
+#endif
+    {
+#ifdef MULTICORE
+        const size_t thread = omp_get_thread_num();
+        const size_t num_threads = omp_get_num_threads();
+#else
+        const size_t thread = 0;
+        const size_t num_threads = 1;
+#endif
+        for (size_t l = 0; l < num_levels; l++)
+        {
+            const size_t begin = this->_level_offsets[l];
+            const size_t end = this->_level_offsets[l + 1];
+
+            /* A wide level is split across threads, with a barrier at the end */
+            if (end - begin >= LEVEL_MIN_WIDTH)
+            {
+#ifdef MULTICORE
+                #pragma omp for schedule(dynamic, 64)
+#endif
+                for (size_t g = begin; g < end; g++)
+                {
+                    const size_t i = this->_level_gates[g];
+                    output[i] = this->evaluate_gate(values, i);
+                }
+                continue;
+            }
+
+            /* Otherwise one thread evaluates the gates of small fan-in */
+#ifdef MULTICORE
+            #pragma omp single
+#endif
+            for (size_t g = begin; g < end; g++)
+            {
+                const size_t i = this->_level_gates[g];
+                if (this->_offsets[i + 1] - this->_offsets[i] < REDUCTION_MIN_FAN_IN) output[i] = this->evaluate_gate(values, i);
+            }
+
+            /* and all threads reduce each gate of large fan-in together */
+            for (size_t g = begin; g < end; g++)
+            {
+                const size_t i = this->_level_gates[g];
+                if (this->_offsets[i + 1] - this->_offsets[i] < REDUCTION_MIN_FAN_IN) continue;
+
+                const bool sum = (this->_types[i] == SUM);
+                FieldT result = sum ? FieldT::zero() : FieldT::one();
+#ifdef MULTICORE
+                #pragma omp for schedule(static) nowait
+#endif
+                for (size_t k = this->_offsets[i]; k < this->_offsets[i + 1]; k++)
+                {
+                    if (sum) result += values[this->_operands[k]];
+                    else result *= values[this->_operands[k]];
+                }
+                partial[thread] = result;
+#ifdef MULTICORE
+                #pragma omp barrier
+                #pragma omp single
+#endif
+                {
+                    FieldT total = partial[0];
+                    for (size_t t = 1; t < num_threads; t++)
+                    {
+                        if (sum) total += partial[t];
+                        else total *= partial[t];
+                    }
+                    output[i] = total;
+                }
+            }
+        }
+    }
+}
+
+template<typename FieldT>
+std::vector<FieldT> compiled_circuit_t<FieldT>::get_scratch() const
+{
+    std::vector<FieldT> scratch(this->_input_size + this->num_gates(), FieldT::zero());
+    scratch.insert(scratch.end(), this->_constants.begin(), this->_constants.end());
+    return scratch;
+}
+
+template<typename FieldT>
+FieldT compiled_circuit_t<FieldT>::evaluate(std::vector<FieldT> &scratch) const
+{
+    assert(scratch.size() == this->_input_size + this->num_gates() + this->num_constants());
+
+    const size_t num_gates = this->num_gates();
+    if (num_gates == 0) return FieldT::zero();
+    INSTRUMENT_COUNT(COUNTER_GATES_EVALUATED, num_gates);
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, this->_num_multiplications);
+
+    FieldT *values = scratch.data();
+    if (this->use_levels())
+    {
+        this->evaluate_levels(scratch);
+        return values[this->_outputs[0]];
+    }
+
+    FieldT *output = values + this->_input_size;
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        output[i] = this->evaluate_gate(values, i);
+    }
+
+    return values[this->_outputs[0]];
+}
+
+template<typename FieldT>
+FieldT compiled_circuit_t<FieldT>::evaluate(const input_t<FieldT> &input, std::vector<FieldT> &scratch) const
+{
+    assert(input.size() == this->_input_size);
+
+    std::copy(input.begin(), input.end(), scratch.begin());
+    return this->evaluate(scratch);
+}
+
+template<typename FieldT>
+std::vector<FieldT> compiled_circuit_t<FieldT>::evaluate_outputs(const input_t<FieldT> &input, std::vector<FieldT> &scratch) const
+{
+    this->evaluate(input, scratch);
+
+    std::vector<FieldT> outputs;
+    for (const uint32_t &output : this->_outputs)
+    {
+        outputs.emplace_back(scratch[output]);
+    }
+    return outputs;
+}
+
+template<typename FieldT>
+std::vector<FieldT> compiled_circuit_t<FieldT>::get_batch_scratch(const size_t &block_size) const
+{
+    std::vector<FieldT> scratch(this->_num_slots * block_size, FieldT::zero());
+    for (size_t i = 0; i < this->num_constants(); i++)
+    {
+        const size_t row = this->_input_size + i;
+        std::fill(scratch.begin() + row * block_size, scratch.begin() + (row + 1) * block_size, this->_constants[i]);
+    }
+    return scratch;
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::evaluate_batch(std::vector<FieldT> &scratch,
+                                                const size_t &block_size,
+                                                const size_t &num_points,
+                                                FieldT *output) const
+{
+    if (this->num_gates() == 0)
+    {
+        std::fill(output, output + num_points, FieldT::zero());
+        return;
+    }
+
+    this->evaluate_rows(scratch, block_size, num_points);
+    const FieldT *result = scratch.data() + this->_batch_outputs[0] * block_size;
+    std::copy(result, result + num_points, output);
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::evaluate_batch_outputs(std::vector<FieldT> &scratch,
+                                                        const size_t &block_size,
+                                                        const size_t &num_points,
+                                                        FieldT *output) const
+{
+    this->evaluate_rows(scratch, block_size, num_points);
+    for (size_t k = 0; k < this->num_outputs(); k++)
+    {
+        const FieldT *result = scratch.data() + this->_batch_outputs[k] * block_size;
+        std::copy(result, result + num_points, output + k * block_size);
+    }
+}
+
+template<typename FieldT>
+std::vector<std::vector<FieldT> > compiled_circuit_t<FieldT>::evaluate_outputs(const std::vector<input_t<FieldT> > &inputs) const
+{
+    const size_t num_points = inputs.size();
+    const size_t num_outputs = std::max<size_t>(this->num_outputs(), 1);
+
+    /* A few points of a large circuit are evaluated one at a time, level by level */
+    if (this->use_levels() && num_points <= LEVEL_MAX_POINTS)
+    {
+        std::vector<std::vector<FieldT> > outputs(num_outputs, std::vector<FieldT>(num_points));
+        std::vector<FieldT> scratch = this->get_scratch();
+        for (size_t p = 0; p < num_points; p++)
+        {
+            const std::vector<FieldT> output = this->evaluate_outputs(inputs[p], scratch);
+            for (size_t k = 0; k < num_outputs; k++) outputs[k][p] = output[k];
+        }
+        return outputs;
+    }
+
+    std::vector<FieldT> scratch = this->get_batch_scratch(num_points);
+    for (size_t p = 0; p < num_points; p++)
+    {
+        assert(inputs[p].size() == this->_input_size);
+        for (size_t j = 0; j < this->_input_size; j++) scratch[j * num_points + p] = inputs[p][j];
+    }
+
+    std::vector<FieldT> output(num_outputs * num_points, FieldT::zero());
+    if (this->num_gates() > 0)
+    {
+        this->evaluate_batch_outputs(scratch, num_points, num_points, output.data());
+    }
+
+    std::vector<std::vector<FieldT> > outputs(num_outputs);
+    for (size_t k = 0; k < num_outputs; k++)
+    {
+        outputs[k].assign(output.begin() + k * num_points, output.begin() + (k + 1) * num_points);
+    }
+    return outputs;
+}
+
+template<typename FieldT>
+void compiled_circuit_t<FieldT>::evaluate_rows(std::vector<FieldT> &scratch,
+                                               const size_t &block_size,
+                                               const size_t &num_points) const
+{
+    assert(num_points <= block_size);
+    assert(scratch.size() == this->_num_slots * block_size);
+
+    const size_t num_gates = this->num_gates();
+    INSTRUMENT_COUNT(COUNTER_GATES_EVALUATED, num_gates * num_points);
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, this->_num_multiplications * num_points);
+
+    FieldT *rows = scratch.data();
+    const uint32_t *operands = this->_batch_operands.data();
+    for (size_t i = 0; i < num_gates; i++)
+    {
+        const uint32_t *operand = operands + this->_offsets[i];
+        const uint32_t *end = operands + this->_offsets[i + 1];
+
+        FieldT *target = rows + this->_batch_targets[i] * block_size;
+        const FieldT *first = rows + (*operand++) * block_size;
+        if (operand == end)
+        {
+            std::copy(first, first + num_points, target);
+        }
+        else if (this->_types[i] == SUM)
+        {
+            const FieldT *second = rows + (*operand++) * block_size;
+            for (size_t p = 0; p < num_points; p++) target[p] = first[p] + second[p];
+            for (; operand != end; operand++)
+            {
+                const FieldT *row = rows + (*operand) * block_size;
+                for (size_t p = 0; p < num_points; p++) target[p] += row[p];
+            }
+        }
+        else
+        {
+            const FieldT *second = rows + (*operand++) * block_size;
+            for (size_t p = 0; p < num_points; p++) target[p] = first[p] * second[p];
+            for (; operand != end; operand++)
+            {
+                const FieldT *row = rows + (*operand) * block_size;
+                for (size_t p = 0; p < num_points; p++) target[p] *= row[p];
+            }
+        }
+    }
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_inputs() const
+{
+    return this->_input_size;
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_outputs() const
+{
+    return this->_outputs.size();
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_gates() const
+{
+    return this->_types.size();
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_multiplications() const
+{
+    return this->_num_multiplications;
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_constants() const
+{
+    return this->_constants.size();
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_slots() const
+{
+    return this->_num_slots;
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::degree() const
+{
+    return this->_degree;
+}
+
+template<typename FieldT>
+size_t compiled_circuit_t<FieldT>::num_levels() const
+{
+    return this->_level_offsets.empty() ? 0 : this->_level_offsets.size() - 1;
+}
+
+template<typename FieldT>
+bool compiled_circuit_t<FieldT>::is_level_parallel() const
+{
+    return this->_level_parallel;
+}
+
+} // bace
+
+#endif // COMPILED_CIRCUIT_TCC_
@@ -0,0 +1,102 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the binary file format.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BINARY_FORMAT_HPP_
+#define BINARY_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "src/common/mapped_file.hpp"
+
+namespace bace {
+
+/*
+ * Binary format of proofs, input batches and circuits.
+ *
+ * A file holds a serialization_header_t, followed at offset
+ * sizeof(serialization_header_t) (a multiple of the cache line) by
+ * num_elements raw field elements, exactly as laid out in memory. Files
+ * can therefore be memory-mapped and used in place, with no parsing or
+ * copying:
+ *
+ * - a proof file holds the first (column_size - 1) * degree + 1
+ *   coefficients of the proof, the remaining coefficients up to
+ *   large_degree being zero for an honest proof (see serialization.hpp);
+ * - an input batch file holds the input_size columns of the batch, each
+ *   column holding its batch_size elements (see mapped_input_batch_t);
+ * - a circuit file holds the constant pool of a compiled circuit, followed
+ *   by a circuit_header_t and the gate table (see compiled_circuit_t::write()).
+ *
+ * field_id identifies the field (and its representation), and checksum
+ * covers the header, taken with a checksum of 0, followed by the rest of the
+ * file, so the sizes of the header are covered along with the data. Readers
+ * reject another version, field or kind.
+ */
+const uint32_t SERIALIZATION_VERSION = 2;
+
+enum serialized_kind_t { SERIALIZED_PROOF = 1, SERIALIZED_INPUT_BATCH = 2, SERIALIZED_CIRCUIT = 3 };
+
+struct serialization_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t field_id;
+    uint64_t element_size;
+    uint64_t batch_size;
+    uint64_t input_size;
+    uint64_t column_size;
+    uint64_t large_degree;
+    uint64_t degree;
+    uint64_t num_elements;
+    uint64_t checksum;
+    uint64_t reserved[5];
+};
+
+/*
+ * Returns an identifier of FieldT, derived from the size and the in-memory
+ * bytes of -1, which depend on the modulus and the representation.
+ */
+template<typename FieldT>
+uint64_t get_field_id();
+
+/*
+ * Returns the checksum of size bytes, chained from a previous checksum.
+ * Chaining over consecutive ranges whose sizes are multiples of 8 bytes
+ * gives the checksum of the whole.
+ */
+uint64_t get_checksum(const char *data, const size_t &size, const uint64_t &checksum);
+
+/*
+ * Returns the checksum of header, taken with a checksum of 0, from which the
+ * checksum of the rest of the file is chained.
+ */
+uint64_t get_header_checksum(const serialization_header_t &header);
+
+/* Returns a header of the given kind for FieldT, with its sizes left at 0 */
+template<typename FieldT>
+serialization_header_t get_header(const serialized_kind_t &kind);
+
+/*
+ * Reads and validates the header of a mapped file of the given kind for
+ * FieldT, throwing std::runtime_error on a mismatch or a truncated file.
+ */
+template<typename FieldT>
+serialization_header_t read_header(const mapped_file_t &file,
+                                   const serialized_kind_t &kind,
+                                   const std::string &path);
+
+} // bace
+
+#include "binary_format.tcc"
+
+#endif // BINARY_FORMAT_HPP_
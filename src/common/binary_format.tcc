@@ -0,0 +1,110 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the binary file format.
+
+ See binary_format.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BINARY_FORMAT_TCC_
+#define BINARY_FORMAT_TCC_
+
+#include <cstring>
+#include <stdexcept>
+
+namespace bace {
+
+const char SERIALIZATION_MAGIC[8] = { 'B', 'A', 'C', 'E', 'B', 'I', 'N', '\0' };
+
+/* FNV-1a offset basis and prime, applied to 64-bit words */
+const uint64_t CHECKSUM_BASIS = 0xcbf29ce484222325ULL;
+const uint64_t CHECKSUM_PRIME = 0x100000001b3ULL;
+
+inline uint64_t get_checksum(const char *data, const size_t &size, const uint64_t &checksum)
+{
+    uint64_t hash = (checksum == 0 ? CHECKSUM_BASIS : checksum);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * CHECKSUM_PRIME;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ uint64_t(static_cast<unsigned char>(data[i]))) * CHECKSUM_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t get_header_checksum(const serialization_header_t &header)
+{
+    serialization_header_t unchecked = header;
+    unchecked.checksum = 0;
+    return get_checksum(reinterpret_cast<const char*>(&unchecked), sizeof(unchecked), 0);
+}
+
+template<typename FieldT>
+uint64_t get_field_id()
+{
+    const FieldT minus_one = -FieldT::one();
+    const uint64_t size = sizeof(FieldT);
+    const uint64_t checksum = get_checksum(reinterpret_cast<const char*>(&size), sizeof(size), 0);
+    return get_checksum(reinterpret_cast<const char*>(&minus_one), sizeof(FieldT), checksum);
+}
+
+template<typename FieldT>
+serialization_header_t get_header(const serialized_kind_t &kind)
+{
+    serialization_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SERIALIZATION_MAGIC, sizeof(header.magic));
+    header.version = SERIALIZATION_VERSION;
+    header.kind = kind;
+    header.field_id = get_field_id<FieldT>();
+    header.element_size = sizeof(FieldT);
+    return header;
+}
+
+template<typename FieldT>
+serialization_header_t read_header(const mapped_file_t &file,
+                                   const serialized_kind_t &kind,
+                                   const std::string &path)
+{
+    serialization_header_t header;
+    if (file.size() < sizeof(header))
+    {
+        throw std::runtime_error("read_header: truncated header in " + path);
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, SERIALIZATION_MAGIC, sizeof(header.magic)) != 0)
+    {
+        throw std::runtime_error("read_header: not a serialized file: " + path);
+    }
+    if (header.version != SERIALIZATION_VERSION)
+    {
+        throw std::runtime_error("read_header: unsupported version in " + path);
+    }
+    if (header.kind != uint32_t(kind))
+    {
+        throw std::runtime_error("read_header: unexpected kind of file in " + path);
+    }
+    if (header.element_size != sizeof(FieldT) || header.field_id != get_field_id<FieldT>())
+    {
+        throw std::runtime_error("read_header: field mismatch in " + path);
+    }
+    if (header.num_elements > (file.size() - sizeof(header)) / sizeof(FieldT))
+    {
+        throw std::runtime_error("read_header: truncated elements in " + path);
+    }
+    return header;
+}
+
+} // bace
+
+#endif // BINARY_FORMAT_TCC_
@@ -0,0 +1,90 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for memory-mapped files.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef MAPPED_FILE_HPP_
+#define MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace bace {
+
+/******************************* MAPPED FILE *********************************/
+
+/*
+ * A memory mapping of a whole file, unmapped when destroyed.
+ *
+ * Mapped pages are brought in by the kernel on access. will_need() starts
+ * reading a range ahead of its use, and dont_need() drops a range from the
+ * resident set once it has been consumed (a later access reads it again),
+ * which is how the streaming prover bounds its resident memory.
+ */
+class mapped_file_t {
+public:
+    /* Maps an existing file, read-only */
+    mapped_file_t(const std::string &path);
+
+    /*
+     * Maps a new read-write file of the given size in directory. The file is
+     * unlinked right away, so it disappears with the mapping.
+     */
+    mapped_file_t(const std::string &directory, const size_t &size);
+
+    ~mapped_file_t();
+
+    mapped_file_t(const mapped_file_t &) = delete;
+    mapped_file_t &operator=(const mapped_file_t &) = delete;
+
+    char *data() const;
+    size_t size() const;
+
+    void will_need(const size_t &offset, const size_t &length) const;
+    void dont_need(const size_t &offset, const size_t &length) const;
+
+private:
+    char *_data;
+    size_t _size;
+
+    void map(const int &fd, const size_t &size, const bool &writable);
+};
+
+/*********************************** ARENA ***********************************/
+
+/*
+ * An anonymous, zero-filled mapping of size bytes, page-aligned, released
+ * when destroyed. It backs the long-lived buffers of a proving_context_t.
+ * A shared arena stays shared with the processes forked after its creation,
+ * which is how the workers of sharded_prover() return their evaluations.
+ *
+ * With huge_pages, transparent huge pages are requested for the mapping
+ * (madvise(MADV_HUGEPAGE)), which cuts TLB misses when the buffers are much
+ * larger than a page. The request is a hint: the kernel may ignore it.
+ */
+class arena_t {
+public:
+    arena_t(const size_t &size, const bool &huge_pages, const bool &shared = false);
+    ~arena_t();
+
+    arena_t(const arena_t &) = delete;
+    arena_t &operator=(const arena_t &) = delete;
+
+    char *data() const;
+    size_t size() const;
+
+private:
+    char *_data;
+    size_t _size;
+};
+
+} // bace
+
+#include "mapped_file.tcc"
+
+#endif // MAPPED_FILE_HPP_
@@ -0,0 +1,152 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for memory-mapped files.
+
+ See mapped_file.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef MAPPED_FILE_TCC_
+#define MAPPED_FILE_TCC_
+
+#include <algorithm>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace bace {
+
+inline mapped_file_t::mapped_file_t(const std::string &path) : _data(nullptr), _size(0)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("mapped_file_t: cannot open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("mapped_file_t: cannot stat " + path);
+    }
+
+    this->map(fd, st.st_size, false);
+    close(fd);
+}
+
+inline mapped_file_t::mapped_file_t(const std::string &directory, const size_t &size) : _data(nullptr), _size(0)
+{
+    std::string path = directory + "/bace-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+
+    const int fd = mkstemp(name.data());
+    if (fd < 0) throw std::runtime_error("mapped_file_t: cannot create a file in " + directory);
+    unlink(name.data());
+
+    if (ftruncate(fd, size) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("mapped_file_t: cannot resize a file in " + directory);
+    }
+
+    this->map(fd, size, true);
+    close(fd);
+}
+
+inline mapped_file_t::~mapped_file_t()
+{
+    if (this->_size > 0) munmap(this->_data, this->_size);
+}
+
+inline void mapped_file_t::map(const int &fd, const size_t &size, const bool &writable)
+{
+    this->_size = size;
+    if (size == 0) return;
+
+    const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *data = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        this->_size = 0;
+        throw std::runtime_error("mapped_file_t: mmap failed");
+    }
+    this->_data = static_cast<char*>(data);
+}
+
+inline char *mapped_file_t::data() const
+{
+    return this->_data;
+}
+
+inline size_t mapped_file_t::size() const
+{
+    return this->_size;
+}
+
+/* madvise() expects page-aligned ranges, so the range is widened to whole pages */
+inline void advise_range(char *data, const size_t &size, const size_t &offset, const size_t &length, const int &advice)
+{
+    if (length == 0 || offset >= size) return;
+
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t begin = offset - offset % page_size;
+    const size_t end = std::min(offset + length, size);
+    madvise(data + begin, end - begin, advice);
+}
+
+inline void mapped_file_t::will_need(const size_t &offset, const size_t &length) const
+{
+    advise_range(this->_data, this->_size, offset, length, MADV_WILLNEED);
+}
+
+inline void mapped_file_t::dont_need(const size_t &offset, const size_t &length) const
+{
+    advise_range(this->_data, this->_size, offset, length, MADV_DONTNEED);
+}
+
+/* Huge pages are 2MB on the usual targets; the mapping is rounded up to them */
+const size_t HUGE_PAGE_SIZE = size_t(1) << 21;
+
+inline arena_t::arena_t(const size_t &size, const bool &huge_pages, const bool &shared) : _data(nullptr), _size(0)
+{
+    if (size == 0) return;
+
+    const size_t alignment = huge_pages ? HUGE_PAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+    const size_t mapped_size = (size + alignment - 1) / alignment * alignment;
+    void *data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) madvise(data, mapped_size, MADV_HUGEPAGE);
+#endif
+    this->_data = static_cast<char*>(data);
+    this->_size = mapped_size;
+}
+
+inline arena_t::~arena_t()
+{
+    if (this->_size > 0) munmap(this->_data, this->_size);
+}
+
+inline char *arena_t::data() const
+{
+    return this->_data;
+}
+
+inline size_t arena_t::size() const
+{
+    return this->_size;
+}
+
+} // bace
+
+#endif // MAPPED_FILE_TCC_
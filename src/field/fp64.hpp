@@ -0,0 +1,121 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for word-sized prime fields.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef FP64_HPP_
+#define FP64_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bace {
+
+/*
+ * Constants of the Montgomery representation of F_p, for an odd modulus
+ * p < 2^64, with R = 2^64. They are computed at compile time.
+ */
+constexpr uint64_t fp64_inverse(const uint64_t p, const uint64_t inverse, const int steps)
+{
+    return steps == 0 ? inverse : fp64_inverse(p, inverse * (2 - p * inverse), steps - 1);
+}
+
+constexpr size_t fp64_two_adicity(const uint64_t x)
+{
+    return (x & 1) ? 0 : 1 + fp64_two_adicity(x >> 1);
+}
+
+constexpr size_t fp64_num_bits(const uint64_t x)
+{
+    return x == 0 ? 0 : 1 + fp64_num_bits(x >> 1);
+}
+
+/*************************** WORD-SIZED PRIME FIELD **************************/
+
+/*
+ * The prime field F_p for an odd modulus p < 2^64, with the interface of
+ * libff's Fp_model, so that it can be used as the FieldT of every template
+ * of this library (circuits, prover, verifier, and radix-2 domains).
+ *
+ * Elements are held in Montgomery form, a * 2^64 mod p, in a single word.
+ * Multiplication is one 64x64 -> 128-bit product and a Montgomery reduction
+ * by subtraction, which stays within 64 bits for any p < 2^64; addition and
+ * subtraction correct the result with masks rather than branches.
+ *
+ * An FFT-friendly modulus (p - 1 divisible by a large power of two, s) gives
+ * radix-2 domains of up to 2^s points. The field is much smaller than the
+ * 254-bit fields of libff, so a verifier check has a soundness error of
+ * about large_degree / p; see get_num_repetitions() for the number of checks
+ * that reaches a target soundness.
+ */
+template<uint64_t modulus>
+class fp64_model_t {
+public:
+    static_assert(modulus % 2 == 1 && modulus > 2, "fp64_model_t expects an odd prime modulus");
+
+    /* Two-adicity of p - 1, root_of_unity is of order 2^s */
+    static constexpr size_t s = fp64_two_adicity(modulus - 1);
+    static constexpr size_t num_bits = fp64_num_bits(modulus);
+    static constexpr size_t num_limbs = 1;
+
+    /* p^{-1} mod 2^64, 2^64 mod p and 2^128 mod p */
+    static constexpr uint64_t inv = fp64_inverse(modulus, modulus, 6);
+    static constexpr uint64_t R = (uint64_t(0) - modulus) % modulus;
+    static constexpr uint64_t Rsquared = uint64_t((((unsigned __int128) 1) << 64) % modulus * (((unsigned __int128) 1) << 64) % modulus);
+
+    /* A quadratic non-residue, and the 2^s-th root of unity it generates */
+    static fp64_model_t<modulus> multiplicative_generator;
+    static fp64_model_t<modulus> root_of_unity;
+
+    uint64_t mont_repr;
+
+    fp64_model_t() : mont_repr(0) {};
+    fp64_model_t(const long x, const bool is_unsigned = false);
+
+    static fp64_model_t<modulus> zero();
+    static fp64_model_t<modulus> one();
+    static fp64_model_t<modulus> random_element();
+
+    bool operator==(const fp64_model_t<modulus> &other) const;
+    bool operator!=(const fp64_model_t<modulus> &other) const;
+    bool is_zero() const;
+
+    fp64_model_t<modulus> &operator+=(const fp64_model_t<modulus> &other);
+    fp64_model_t<modulus> &operator-=(const fp64_model_t<modulus> &other);
+    fp64_model_t<modulus> &operator*=(const fp64_model_t<modulus> &other);
+
+    fp64_model_t<modulus> operator+(const fp64_model_t<modulus> &other) const;
+    fp64_model_t<modulus> operator-(const fp64_model_t<modulus> &other) const;
+    fp64_model_t<modulus> operator*(const fp64_model_t<modulus> &other) const;
+    fp64_model_t<modulus> operator-() const;
+    fp64_model_t<modulus> operator^(const unsigned long pow) const;
+
+    fp64_model_t<modulus> squared() const;
+    fp64_model_t<modulus> inverse() const;
+
+    /* Returns the canonical representative in [0, p) */
+    unsigned long as_ulong() const;
+
+    void print() const;
+
+    static size_t size_in_bits() { return num_bits; }
+
+private:
+    static uint64_t reduce(const unsigned __int128 &t);
+    static fp64_model_t<modulus> find_multiplicative_generator();
+};
+
+/* The prime 2^64 - 2^32 + 1, with a two-adicity of 32 */
+const uint64_t GOLDILOCKS_MODULUS = 0xffffffff00000001ULL;
+typedef fp64_model_t<GOLDILOCKS_MODULUS> fp64_t;
+
+} // bace
+
+#include "fp64.tcc"
+
+#endif // FP64_HPP_
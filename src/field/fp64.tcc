@@ -0,0 +1,236 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for word-sized prime fields.
+
+ See fp64.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef FP64_TCC_
+#define FP64_TCC_
+
+#include <cassert>
+#include <random>
+#include <stdio.h>
+
+namespace bace {
+
+template<uint64_t modulus>
+constexpr size_t fp64_model_t<modulus>::s;
+
+template<uint64_t modulus>
+constexpr size_t fp64_model_t<modulus>::num_bits;
+
+template<uint64_t modulus>
+constexpr size_t fp64_model_t<modulus>::num_limbs;
+
+template<uint64_t modulus>
+constexpr uint64_t fp64_model_t<modulus>::inv;
+
+template<uint64_t modulus>
+constexpr uint64_t fp64_model_t<modulus>::R;
+
+template<uint64_t modulus>
+constexpr uint64_t fp64_model_t<modulus>::Rsquared;
+
+/* Both are computed from constants only, as their initialization order is unspecified */
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::multiplicative_generator =
+    fp64_model_t<modulus>::find_multiplicative_generator();
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::root_of_unity =
+    fp64_model_t<modulus>::find_multiplicative_generator() ^ ((modulus - 1) >> fp64_model_t<modulus>::s);
+
+/*
+ * Returns t / 2^64 mod p, for t < p * 2^64. With m = t * p^{-1} mod 2^64,
+ * t - m * p is divisible by 2^64, and (t - m * p) / 2^64 lies in (-p, p).
+ */
+template<uint64_t modulus>
+uint64_t fp64_model_t<modulus>::reduce(const unsigned __int128 &t)
+{
+    const uint64_t t_lo = uint64_t(t);
+    const uint64_t t_hi = uint64_t(t >> 64);
+    const uint64_t m = t_lo * inv;
+    const uint64_t mp_hi = uint64_t(((unsigned __int128) m * modulus) >> 64);
+
+    const uint64_t result = t_hi - mp_hi;
+    return result + (modulus & (uint64_t(0) - uint64_t(t_hi < mp_hi)));
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus>::fp64_model_t(const long x, const bool is_unsigned)
+{
+    uint64_t value;
+    if (is_unsigned || x >= 0)
+    {
+        value = uint64_t(x) % modulus;
+    }
+    else
+    {
+        const uint64_t magnitude = (uint64_t(-(x + 1)) + 1) % modulus;
+        value = (modulus - magnitude) % modulus;
+    }
+    this->mont_repr = reduce((unsigned __int128) value * Rsquared);
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::zero()
+{
+    return fp64_model_t<modulus>();
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::one()
+{
+    fp64_model_t<modulus> result;
+    result.mont_repr = R;
+    return result;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::random_element()
+{
+    /* Rejection sampling of a uniform word below p, which is uniform in Montgomery form too */
+    static thread_local std::random_device device;
+    uint64_t value;
+    do
+    {
+        value = (uint64_t(device()) << 32) | uint64_t(device());
+    } while (value >= modulus);
+
+    fp64_model_t<modulus> result;
+    result.mont_repr = value;
+    return result;
+}
+
+template<uint64_t modulus>
+bool fp64_model_t<modulus>::operator==(const fp64_model_t<modulus> &other) const
+{
+    return this->mont_repr == other.mont_repr;
+}
+
+template<uint64_t modulus>
+bool fp64_model_t<modulus>::operator!=(const fp64_model_t<modulus> &other) const
+{
+    return this->mont_repr != other.mont_repr;
+}
+
+template<uint64_t modulus>
+bool fp64_model_t<modulus>::is_zero() const
+{
+    return this->mont_repr == 0;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> &fp64_model_t<modulus>::operator+=(const fp64_model_t<modulus> &other)
+{
+    /* a + b - p is kept when the sum overflows the word, or is at least p */
+    const uint64_t sum = this->mont_repr + other.mont_repr;
+    const uint64_t carry = uint64_t(sum < this->mont_repr);
+    const uint64_t below = uint64_t(sum < modulus);
+    const uint64_t mask = uint64_t(0) - (carry | (below ^ 1));
+    this->mont_repr = sum - (modulus & mask);
+    return *this;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> &fp64_model_t<modulus>::operator-=(const fp64_model_t<modulus> &other)
+{
+    const uint64_t borrow = uint64_t(this->mont_repr < other.mont_repr);
+    this->mont_repr = this->mont_repr - other.mont_repr + (modulus & (uint64_t(0) - borrow));
+    return *this;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> &fp64_model_t<modulus>::operator*=(const fp64_model_t<modulus> &other)
+{
+    this->mont_repr = reduce((unsigned __int128) this->mont_repr * other.mont_repr);
+    return *this;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::operator+(const fp64_model_t<modulus> &other) const
+{
+    fp64_model_t<modulus> result(*this);
+    return result += other;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::operator-(const fp64_model_t<modulus> &other) const
+{
+    fp64_model_t<modulus> result(*this);
+    return result -= other;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::operator*(const fp64_model_t<modulus> &other) const
+{
+    fp64_model_t<modulus> result(*this);
+    return result *= other;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::operator-() const
+{
+    fp64_model_t<modulus> result;
+    result.mont_repr = (modulus - this->mont_repr) & (uint64_t(0) - uint64_t(this->mont_repr != 0));
+    return result;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::operator^(const unsigned long pow) const
+{
+    fp64_model_t<modulus> result = one();
+    fp64_model_t<modulus> base = *this;
+    for (unsigned long e = pow; e != 0; e >>= 1)
+    {
+        if (e & 1) result *= base;
+        base *= base;
+    }
+    return result;
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::squared() const
+{
+    return (*this) * (*this);
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::inverse() const
+{
+    assert(!this->is_zero());
+    return (*this) ^ (modulus - 2);
+}
+
+template<uint64_t modulus>
+unsigned long fp64_model_t<modulus>::as_ulong() const
+{
+    return reduce(this->mont_repr);
+}
+
+template<uint64_t modulus>
+void fp64_model_t<modulus>::print() const
+{
+    printf("%lu\n", this->as_ulong());
+}
+
+template<uint64_t modulus>
+fp64_model_t<modulus> fp64_model_t<modulus>::find_multiplicative_generator()
+{
+    const fp64_model_t<modulus> minus_one = -one();
+    for (long g = 2; ; g++)
+    {
+        const fp64_model_t<modulus> candidate(g);
+        if ((candidate ^ ((modulus - 1) / 2)) == minus_one) return candidate;
+    }
+}
+
+} // bace
+
+#endif // FP64_TCC_
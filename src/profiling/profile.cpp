@@ -1,15 +1,29 @@
 /** @file
  *****************************************************************************
  Implementation of functions for profiler.
+
+ The profiler sweeps fields, circuit families, batch sizes, input sizes and
+ thread counts, given on the command line (see usage() below). Every
+ configuration is run a number of warmup times, then measured over a number
+ of repetitions, reporting the median, 95th percentile and peak resident
+ memory of each operation, and, when built with INSTRUMENTATION, a breakdown
+ of the prover and the verifier into the phases they record.
+
+ Results are written to results.csv and results.json, alongside the CSV
+ files and gnuplot plots of each field and circuit, and can be compared
+ against the results.csv of an earlier run to flag regressions.
  *****************************************************************************
  * @author     This file is part of bace, developed by SCIPR Lab
  *             and contributors (see AUTHORS).
  * @copyright  MIT license (see LICENSE file)
  *****************************************************************************/
 
+#include <algorithm>
 #include <ctime>
 #include <iostream>
 #include <fstream>
+#include <getopt.h>
+#include <map>
 #include <omp.h>
 #include <sstream>
 #include <stdio.h>
@@ -23,12 +37,152 @@
 #include "algebra/curves/alt_bn128/alt_bn128_pp.hpp"
 #include "common/double.hpp"
 
+#include "src/field/fp64.hpp"
 #include "src/proof_system/prover.hpp"
 #include "src/proof_system/verifier.hpp"
 #include "src/proof_system/naive_evaluation.hpp"
+#include "src/proof_system/numa.hpp"
+#include "src/proof_system/proving_context.hpp"
 
 using namespace bace;
 
+/* Phases of the prover and of the verifier, in order */
+const std::vector<phase_t> PROVER_PHASES = { PHASE_COLUMN_LDE, PHASE_COSET_FFT, PHASE_COSET_EVALUATION, PHASE_PROOF_IFFT };
+const std::vector<phase_t> VERIFIER_PHASES = { PHASE_VERIFY_LDE, PHASE_VERIFY_CIRCUIT, PHASE_VERIFY_PROOF, PHASE_EXTRACT_OUTPUT };
+
+struct options_t
+{
+    std::vector<std::string> fields;
+    std::vector<std::string> circuits;
+    std::vector<size_t> batch_sizes;
+    std::vector<size_t> input_sizes;
+    std::vector<size_t> threads;
+    std::vector<memory_placement_t> placements;
+    size_t warmup;
+    size_t repetitions;
+    bool optimize;
+    bool plot;
+    std::string output_directory;
+    std::string baseline_path;
+    double tolerance;
+};
+
+struct summary_t
+{
+    double median;
+    double p95;
+    double min;
+    double max;
+};
+
+struct result_t
+{
+    std::string field;
+    std::string circuit;
+    std::string operation;
+    size_t batch_size;
+    size_t input_size;
+    size_t threads;
+    size_t circuit_size;
+    size_t degree;
+    summary_t time;
+    long peak_rss_kb;
+    std::map<std::string, double> phases; // Median time of each phase, by get_phase_name()
+};
+
+/******************************** UTILITIES **********************************/
+
+void usage(const char *name)
+{
+    printf("Usage: %s [options]\n", name);
+    printf("  --fields LIST        fields among alt_bn128, fp64%s (default: %s)\n",
+#ifdef PROF_DOUBLE
+           ", double", "double"
+#else
+           "", "alt_bn128"
+#endif
+    );
+    printf("  --circuits LIST      circuit families among quadratic, inner_product (default: quadratic)\n");
+    printf("  --batch-sizes SIZES  batch sizes (default: 2:128)\n");
+    printf("  --input-sizes SIZES  input sizes (default: 2:4096)\n");
+    printf("  --threads SIZES      thread counts (default: 1:max threads)\n");
+    printf("  --placements LIST    also profile the proving context under placements among naive, local, interleaved\n");
+    printf("  --warmup N           unmeasured runs per configuration (default: 1)\n");
+    printf("  --repetitions N      measured runs per configuration (default: 3)\n");
+    printf("  --optimize           profile circuits after optimize()\n");
+    printf("  --no-plot            skip the gnuplot plots\n");
+    printf("  --output DIRECTORY   log directory (default: src/profiling/logs/{datetime}/)\n");
+    printf("  --baseline FILE      results.csv of an earlier run to compare against\n");
+    printf("  --tolerance X        relative slowdown flagged as a regression (default: 0.1)\n");
+    printf("LIST is comma-separated. SIZES is comma-separated, or a:b for the powers of two from a to b.\n");
+}
+
+std::vector<std::string> parse_list(const std::string &argument)
+{
+    std::vector<std::string> list;
+    std::stringstream stream(argument);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty()) list.emplace_back(item);
+    }
+    return list;
+}
+
+std::vector<size_t> parse_sizes(const std::string &argument)
+{
+    std::vector<size_t> sizes;
+    const size_t colon = argument.find(':');
+    if (colon != std::string::npos)
+    {
+        const size_t first = strtoul(argument.substr(0, colon).c_str(), nullptr, 10);
+        const size_t last = strtoul(argument.substr(colon + 1).c_str(), nullptr, 10);
+        for (size_t size = std::max<size_t>(first, 1); size <= last; size *= 2) sizes.emplace_back(size);
+    }
+    else
+    {
+        for (const std::string &item : parse_list(argument)) sizes.emplace_back(strtoul(item.c_str(), nullptr, 10));
+    }
+    return sizes;
+}
+
+summary_t summarize(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    summary_t summary;
+    summary.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    summary.p95 = samples[std::min(n - 1, (size_t) (0.95 * n))];
+    summary.min = samples.front();
+    summary.max = samples.back();
+    return summary;
+}
+
+/*
+ * Resets the peak resident set size of the process (VmHWM), so that it can
+ * be read back for a single run. This needs Linux 4.0 or later; otherwise,
+ * the peak of the whole process is reported.
+ */
+void reset_peak_rss()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) clear_refs << "5";
+}
+
+long get_peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0) return strtol(line.c_str() + 6, nullptr, 10);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
 void plot(const std::string &path)
 {
     /* System Call */
@@ -36,127 +190,318 @@ void plot(const std::string &path)
     if (system(cmd.c_str()) == 0) printf("Plotted profile to %s\n", path.c_str());
 }
 
-template <typename FieldT>
-std::pair<std::pair<double, double>, std::pair<size_t, size_t> > profile(const std::vector<std::vector<FieldT> > &input_batch,
-                                                                         const size_t &input_size,
-                                                                         const std::string &type)
+/********************************* PROFILING *********************************/
+
+template<typename FieldT>
+arithmetic_circuit_t<FieldT> get_circuit(const std::string &family, const size_t &input_size, const bool &optimize)
 {
-    double start;
-    double end;
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    if (family == "inner_product") circuit.add_inner_product_gates();
+    else circuit.add_quadratic_inner_product_gates();
 
-    double start_prover;
-    double end_prover;
+    if (optimize) circuit.optimize();
+    return circuit;
+}
 
-    proof_t<FieldT> proof;
-    std::vector<FieldT> output_batch;
+/* Adds the time of each of the phases recorded since the last reset to phase_times */
+void record_phase_times(const std::vector<phase_t> &phases, std::map<std::string, std::vector<double> > &phase_times)
+{
+    const instrumentation_stats_t stats = get_instrumentation_stats();
+    for (const phase_t &phase : phases) phase_times[get_phase_name(phase)].emplace_back(stats.seconds[phase]);
+}
 
-    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
-    circuit.add_quadratic_inner_product_gates();
+/* Profiles naive evaluation, the prover and the verifier on one configuration */
+template<typename FieldT>
+void profile(const options_t &options,
+             const std::string &field,
+             const std::string &family,
+             const size_t &batch_size,
+             const size_t &input_size,
+             const size_t &num_threads,
+             std::vector<result_t> &results)
+{
+    const arithmetic_circuit_t<FieldT> circuit = get_circuit<FieldT>(family, input_size, options.optimize);
 
-    /* Perform operation */
-    if (type == "naive")
+    input_batch_t<FieldT> input_batch(batch_size, std::vector<FieldT>(input_size));
+    for (size_t k = 0; k < batch_size; k++)
     {
-        start = omp_get_wtime();
-        naive_evaluate(circuit, input_batch, output_batch);
-        end = omp_get_wtime() - start;
+        for (size_t l = 0; l < input_size; l++) input_batch[k][l] = FieldT::random_element();
     }
-    else
+
+    result_t result;
+    result.field = field;
+    result.circuit = family;
+    result.batch_size = batch_size;
+    result.input_size = input_size;
+    result.threads = num_threads;
+    result.circuit_size = circuit.size();
+    result.degree = circuit.degree();
+
+    std::vector<double> naive_times, prover_times, verifier_times;
+    std::map<std::string, std::vector<double> > prover_phase_times, verifier_phase_times;
+    long naive_rss = 0, prover_rss = 0, verifier_rss = 0;
+    for (size_t r = 0; r < options.warmup + options.repetitions; r++)
     {
-        start_prover = omp_get_wtime();
+        const bool measured = (r >= options.warmup);
+        output_batch_t<FieldT> output_batch;
+        proof_t<FieldT> proof;
+
+        reset_peak_rss();
+        double start = omp_get_wtime();
+        naive_evaluate(circuit, input_batch, output_batch);
+        const double naive_time = omp_get_wtime() - start;
+        naive_rss = std::max(naive_rss, get_peak_rss_kb());
+
+        /* The phases are those recorded by the measured prover() and verifier() runs themselves */
+        reset_peak_rss();
+        reset_instrumentation_stats();
+        start = omp_get_wtime();
         prover(circuit, input_batch, proof);
-        end_prover = omp_get_wtime() - start_prover;
+        const double prover_time = omp_get_wtime() - start;
+        prover_rss = std::max(prover_rss, get_peak_rss_kb());
+        if (measured && is_instrumented()) record_phase_times(PROVER_PHASES, prover_phase_times);
 
+        reset_peak_rss();
+        reset_instrumentation_stats();
         start = omp_get_wtime();
         verifier(circuit, input_batch, output_batch, proof);
-        end = omp_get_wtime() - start;
-    }
+        const double verifier_time = omp_get_wtime() - start;
+        verifier_rss = std::max(verifier_rss, get_peak_rss_kb());
+        if (measured && is_instrumented()) record_phase_times(VERIFIER_PHASES, verifier_phase_times);
 
-    return std::make_pair(std::make_pair(end, end_prover), std::make_pair(circuit.degree(), circuit.size()));
-}
+        if (!measured) continue;
+        naive_times.emplace_back(naive_time);
+        prover_times.emplace_back(prover_time);
+        verifier_times.emplace_back(verifier_time);
+    }
 
-template <typename FieldT>
-void initialize(const std::string &path, const std::string &type, const int &num_threads)
-{
-    size_t batch_size;
-    size_t input_size;
+    result.operation = "naive";
+    result.time = summarize(naive_times);
+    result.peak_rss_kb = naive_rss;
+    results.emplace_back(result);
 
-    double runtime;
-    double runtime_prover;
-    size_t degree;
-    size_t circuit_size;
+    result.operation = "prover";
+    result.time = summarize(prover_times);
+    result.peak_rss_kb = prover_rss;
+    for (const auto &times : prover_phase_times) result.phases[times.first] = summarize(times.second).median;
+    results.emplace_back(result);
 
-    std::pair<std::pair<double, double>, std::pair<size_t, size_t> > profile_stats;
+    result.operation = "verifier";
+    result.time = summarize(verifier_times);
+    result.peak_rss_kb = verifier_rss;
+    result.phases.clear();
+    for (const auto &times : verifier_phase_times) result.phases[times.first] = summarize(times.second).median;
+    results.emplace_back(result);
+    result.phases.clear();
 
-    /* Runtime File */
-    std::ofstream runtime_file;
-    runtime_file.open(path + type + "-" + std::to_string(num_threads) + "-thread.csv");
-    runtime_file << "batch_size, input_size, circuit_size, degree, time (in sec)\n";
+    printf("batch_size %zu, input_size %zu, circuit_size %zu, degree %zu: naive %f, prover %f, verifier %f seconds (median)\n",
+           batch_size, input_size, result.circuit_size, result.degree,
+           results[results.size() - 3].time.median, results[results.size() - 2].time.median, result.time.median);
 
-    std::ofstream prover_runtime_file;
-    if (type == "verifier")
+    /* The proving context under each placement, as operation prover-{placement} */
+    for (const memory_placement_t &placement : options.placements)
     {
-        prover_runtime_file.open(path + "prover-" + std::to_string(num_threads) + "-thread.csv");
-        prover_runtime_file << "batch_size, input_size, circuit_size, degree, time (in sec)\n";
-    }
+        proving_context_t<FieldT> context(circuit, false, placement);
+        std::vector<double> context_times;
+        long context_rss = 0;
+        for (size_t r = 0; r < options.warmup + options.repetitions; r++)
+        {
+            reset_peak_rss();
+            const double start = omp_get_wtime();
+            context.prove(input_batch);
+            const double context_time = omp_get_wtime() - start;
+            context_rss = std::max(context_rss, get_peak_rss_kb());
+            if (r >= options.warmup) context_times.emplace_back(context_time);
+        }
 
-    printf("\n%s-%d-thread\n", type.c_str(), num_threads);
+        result.operation = "prover-" + get_placement_name(placement);
+        result.time = summarize(context_times);
+        result.peak_rss_kb = context_rss;
+        results.emplace_back(result);
+        printf("  %s: %f seconds (median)%s\n", result.operation.c_str(), result.time.median,
+               context.is_placed() ? "" : ", placement not applied");
+    }
+}
 
-    /* Assess on varying domain sizes */
-    std::vector<std::vector<FieldT> > input_batch;
-    for (int i = 1; i < 8; i++) /* batch_size */
+/*
+ * Sweeps a field over all circuits, sizes and thread counts. Each field and
+ * circuit gets a directory of CSV files in the layout of runtime_plot.gp.
+ */
+template<typename FieldT>
+void profile_field(const options_t &options, const std::string &field, std::vector<result_t> &results)
+{
+    for (const std::string &family : options.circuits)
     {
-        for (int j = 1; j < 13; j++) /* input_size */
+        const std::string path = options.output_directory + field + "-" + family + "/";
+        if (system(("mkdir -p " + path).c_str())) return;
+
+        for (const size_t &num_threads : options.threads)
         {
-            /* Initialization */
-            batch_size = pow(2, i);
-            input_size = pow(2, j);
+            /* Fix number of threads, no dynamic adjustment */
+            omp_set_dynamic(0);
+            omp_set_num_threads(num_threads);
+            printf("\n%s, %s, %zu-thread\n", field.c_str(), family.c_str(), num_threads);
 
-            input_batch.resize(batch_size);
-            for (int k = 0; k < batch_size; k++)
+            std::map<std::string, std::ofstream> files;
+            for (const char *operation : { "naive", "prover", "verifier" })
             {
-                input_batch[k] = std::vector<FieldT>(input_size);
-                for (int l = 0; l < input_size; l++)
-                {
-                    input_batch[k][l] = FieldT::random_element();
-                }
+                files[operation].open(path + operation + "-" + std::to_string(num_threads) + "-thread.csv");
+                files[operation] << "batch_size, input_size, circuit_size, degree, time (in sec)\n";
             }
-            
-            /* Profiling */
-            profile_stats = profile<FieldT>(input_batch, input_size, type);
-            runtime = profile_stats.first.first;
-            runtime_prover = profile_stats.first.second;
-            degree = profile_stats.second.first;
-            circuit_size = profile_stats.second.second;
-
-            /* Logging */
-            runtime_file << batch_size << "," << input_size << "," << circuit_size << "," << degree << "," << runtime << "\n";
-            if (type == "verifier")
+
+            for (const size_t &batch_size : options.batch_sizes)
             {
-                prover_runtime_file << batch_size << "," << input_size << "," << circuit_size << "," << degree << "," << runtime_prover << "\n";
-                prover_runtime_file.flush();
+                for (const size_t &input_size : options.input_sizes)
+                {
+                    const size_t first = results.size();
+                    profile<FieldT>(options, field, family, batch_size, input_size, num_threads, results);
+                    for (size_t i = first; i < results.size(); i++)
+                    {
+                        const result_t &result = results[i];
+                        if (files.count(result.operation) == 0) continue;
+                        files[result.operation] << result.batch_size << "," << result.input_size << ","
+                                                << result.circuit_size << "," << result.degree << ","
+                                                << result.time.median << "\n";
+                        files[result.operation].flush();
+                    }
+                }
+                for (auto &file : files) file.second << ",,,,\n";
             }
-            printf("batch_size %ld, input_size %ld, circuit_size %ld, degree %ld, %f seconds\n", batch_size, input_size, circuit_size, degree, runtime);
-            
-            runtime_file.flush();
-            input_batch.clear();
         }
 
-        runtime_file << ",,,,\n";
-        runtime_file.flush();
-        if (type == "verifier")
+        if (options.plot) plot(path);
+    }
+}
+
+/********************************* REPORTING *********************************/
+
+std::string get_key(const std::string &field, const std::string &circuit, const std::string &operation,
+                    const size_t &batch_size, const size_t &input_size, const size_t &threads)
+{
+    return field + "," + circuit + "," + operation + "," + std::to_string(batch_size) + ","
+        + std::to_string(input_size) + "," + std::to_string(threads);
+}
+
+void write_csv(const std::string &path, const std::vector<result_t> &results)
+{
+    std::ofstream file(path);
+    file << "field,circuit,operation,batch_size,input_size,threads,circuit_size,degree,"
+         << "median,p95,min,max,peak_rss_kb";
+    for (size_t phase = 0; phase < NUM_PHASES; phase++) file << "," << get_phase_name(phase_t(phase));
+    file << "\n";
+
+    for (const result_t &result : results)
+    {
+        file << get_key(result.field, result.circuit, result.operation, result.batch_size, result.input_size, result.threads)
+             << "," << result.circuit_size << "," << result.degree << "," << result.time.median << "," << result.time.p95
+             << "," << result.time.min << "," << result.time.max << "," << result.peak_rss_kb;
+        for (size_t phase = 0; phase < NUM_PHASES; phase++)
+        {
+            const auto it = result.phases.find(get_phase_name(phase_t(phase)));
+            file << "," << (it == result.phases.end() ? 0 : it->second);
+        }
+        file << "\n";
+    }
+}
+
+/* Returns value as a JSON string, quoted and escaped */
+std::string get_json_string(const std::string &value)
+{
+    std::string json = "\"";
+    for (const char &c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            json += '\\';
+            json += c;
+        }
+        else if ((unsigned char) c < 0x20)
         {
-            prover_runtime_file << ",,,,\n";
-            prover_runtime_file.flush(); 
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        }
+        else
+        {
+            json += c;
         }
-        printf("\n");
     }
+    return json + "\"";
+}
 
-    /* Close file */
-    runtime_file.close();
-    if (type == "verifier") prover_runtime_file.close();
+void write_json(const std::string &path, const std::vector<result_t> &results)
+{
+    std::ofstream file(path);
+    file << "[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const result_t &result = results[i];
+        file << "  { \"field\": " << get_json_string(result.field) << ", \"circuit\": " << get_json_string(result.circuit)
+             << ", \"operation\": " << get_json_string(result.operation) << ", \"batch_size\": " << result.batch_size
+             << ", \"input_size\": " << result.input_size << ", \"threads\": " << result.threads
+             << ", \"circuit_size\": " << result.circuit_size << ", \"degree\": " << result.degree
+             << ", \"median\": " << result.time.median << ", \"p95\": " << result.time.p95
+             << ", \"min\": " << result.time.min << ", \"max\": " << result.time.max
+             << ", \"peak_rss_kb\": " << result.peak_rss_kb << ", \"phases\": {";
+        for (auto it = result.phases.begin(); it != result.phases.end(); it++)
+        {
+            file << (it == result.phases.begin() ? " " : ", ") << get_json_string(it->first) << ": " << it->second;
+        }
+        file << (result.phases.empty() ? "}" : " }") << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "]\n";
 }
 
-int main()
+/*
+ * Compares the medians against the results.csv of an earlier run, and returns
+ * the number of configurations slower than their baseline by more than the
+ * tolerance. Differences under a millisecond are treated as noise, and
+ * configurations missing from the baseline are skipped.
+ */
+size_t compare_baseline(const std::string &path, const std::vector<result_t> &results, const double &tolerance)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        printf("Cannot read baseline %s\n", path.c_str());
+        return 0;
+    }
+
+    /* The key is the first 6 columns, the median the 9th */
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> columns;
+        std::stringstream stream(line);
+        std::string column;
+        while (std::getline(stream, column, ',')) columns.emplace_back(column);
+        if (columns.size() < 9) continue;
+
+        const std::string key = columns[0] + "," + columns[1] + "," + columns[2] + "," + columns[3] + "," + columns[4] + "," + columns[5];
+        baseline[key] = strtod(columns[8].c_str(), nullptr);
+    }
+
+    size_t num_regressions = 0;
+    for (const result_t &result : results)
+    {
+        const std::string key = get_key(result.field, result.circuit, result.operation, result.batch_size, result.input_size, result.threads);
+        const auto it = baseline.find(key);
+        if (it == baseline.end()) continue;
+
+        if (result.time.median > it->second * (1 + tolerance) && result.time.median - it->second > 1e-3)
+        {
+            printf("REGRESSION %s: %f -> %f seconds (%+.1f%%)\n", key.c_str(), it->second, result.time.median,
+                   100 * (result.time.median / it->second - 1));
+            num_regressions++;
+        }
+    }
+    printf("%zu regressions against %s\n", num_regressions, path.c_str());
+    return num_regressions;
+}
+
+int main(int argc, char **argv)
 {
   /* Get Current Timestamp */
   time_t rawtime;
@@ -166,31 +511,102 @@ int main()
   strftime(buffer, 40, "%m-%d_%I:%M", timeinfo);
   std::string datetime(buffer);
 
+  /* Defaults reproduce the original sweep: the baseline field, and circuits as built */
+  options_t options;
+#ifdef PROF_DOUBLE
+  options.fields = { "double" };
+#else
+  options.fields = { "alt_bn128" };
+#endif
+  options.circuits = { "quadratic" };
+  options.batch_sizes = parse_sizes("2:128");
+  options.input_sizes = parse_sizes("2:4096");
+  options.threads = parse_sizes("1:" + std::to_string(omp_get_max_threads()));
+  options.warmup = 1;
+  options.repetitions = 3;
+  options.optimize = false;
+  options.plot = true;
+  options.output_directory = "src/profiling/logs/" + datetime + "/";
+  options.tolerance = 0.1;
+
+  const struct option long_options[] = {
+    { "fields", required_argument, nullptr, 'f' },
+    { "circuits", required_argument, nullptr, 'c' },
+    { "batch-sizes", required_argument, nullptr, 'b' },
+    { "input-sizes", required_argument, nullptr, 'i' },
+    { "threads", required_argument, nullptr, 't' },
+    { "placements", required_argument, nullptr, 'p' },
+    { "warmup", required_argument, nullptr, 'w' },
+    { "repetitions", required_argument, nullptr, 'r' },
+    { "optimize", no_argument, nullptr, 'O' },
+    { "no-plot", no_argument, nullptr, 'P' },
+    { "output", required_argument, nullptr, 'o' },
+    { "baseline", required_argument, nullptr, 'B' },
+    { "tolerance", required_argument, nullptr, 'T' },
+    { "help", no_argument, nullptr, 'h' },
+    { nullptr, 0, nullptr, 0 }
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "h", long_options, nullptr)) != -1)
+  {
+    switch (option)
+    {
+      case 'f': options.fields = parse_list(optarg); break;
+      case 'c': options.circuits = parse_list(optarg); break;
+      case 'b': options.batch_sizes = parse_sizes(optarg); break;
+      case 'i': options.input_sizes = parse_sizes(optarg); break;
+      case 't': options.threads = parse_sizes(optarg); break;
+      case 'p':
+        options.placements.clear();
+        for (const std::string &name : parse_list(optarg)) options.placements.emplace_back(get_memory_placement(name));
+        break;
+      case 'w': options.warmup = strtoul(optarg, nullptr, 10); break;
+      case 'r': options.repetitions = std::max<size_t>(1, strtoul(optarg, nullptr, 10)); break;
+      case 'O': options.optimize = true; break;
+      case 'P': options.plot = false; break;
+      case 'o': options.output_directory = std::string(optarg) + "/"; break;
+      case 'B': options.baseline_path = optarg; break;
+      case 'T': options.tolerance = strtod(optarg, nullptr); break;
+      default: usage(argv[0]); return (option == 'h') ? 0 : 1;
+    }
+  }
+
   /* Make log file directory */
-  std::string path = "src/profiling/logs/" + datetime + "/";
-  if (system( ("mkdir -p " + path).c_str() )) return 0;
+  if (system( ("mkdir -p " + options.output_directory).c_str() )) return 0;
 
-  /* Profile on 1, 2, 4, or 8 threads */
-  const int max_threads = omp_get_max_threads();
-  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+  std::vector<result_t> results;
+  for (const std::string &field : options.fields)
   {
-    /* Fix number of threads, no dynamic adjustment */
-    omp_set_dynamic(0);
-    omp_set_num_threads(num_threads);
-
-#ifndef PROF_DOUBLE
-    printf("Profiling with alt_bn128_pp\n");
-    libff::alt_bn128_pp::init_public_params();
-    initialize<libff::Fr<libff::alt_bn128_pp> >(path, "naive", num_threads);
-    initialize<libff::Fr<libff::alt_bn128_pp> >(path, "verifier", num_threads);
-#else
-    printf("Profiling with Double\n");
-    initialize<libff::Double>(path, "naive", num_threads);
-    initialize<libff::Double>(path, "verifier", num_threads);
+    if (field == "alt_bn128")
+    {
+      printf("Profiling with alt_bn128_pp\n");
+      libff::alt_bn128_pp::init_public_params();
+      profile_field<libff::Fr<libff::alt_bn128_pp> >(options, field, results);
+    }
+    else if (field == "fp64")
+    {
+      printf("Profiling with fp64_t\n");
+      profile_field<fp64_t>(options, field, results);
+    }
+#ifdef PROF_DOUBLE
+    else if (field == "double")
+    {
+      printf("Profiling with Double\n");
+      profile_field<libff::Double>(options, field, results);
+    }
 #endif
+    else
+    {
+      printf("Unknown field %s\n", field.c_str());
+    }
   }
 
-  plot(path);
-  
+  write_csv(options.output_directory + "results.csv", results);
+  write_json(options.output_directory + "results.json", results);
+  printf("Saved results to %s\n", options.output_directory.c_str());
+
+  if (!options.baseline_path.empty() && compare_baseline(options.baseline_path, results, options.tolerance) > 0) return 1;
+
   return 0;
 }
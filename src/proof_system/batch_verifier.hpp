@@ -0,0 +1,63 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for batch verification.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BATCH_VERIFIER_HPP_
+#define BATCH_VERIFIER_HPP_
+
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/proof_system/common.hpp"
+
+namespace bace {
+
+/* Outcome of batch_verifier(), per proof and in aggregate */
+struct batch_verification_stats_t
+{
+    std::vector<bool> accepted;     // Whether proof i passed its check
+    size_t num_accepted;
+    double seconds;                 // Wall-clock time of the whole batch
+    double proofs_per_second;
+};
+
+/*
+ * Verifies N proofs for the same circuit, given N input batches of the same
+ * batch_size, and returns one output batch per proof, left empty for a
+ * rejected proof, exactly as N calls to verifier() would.
+ *
+ * The setup that only depends on the circuit and the batch shape is done
+ * once: the circuit is compiled once, the domains are shared, and all
+ * proofs are checked at the same num_repetitions random elements, drawn
+ * after the proofs are given, so that the barycentric weights of the
+ * elements are computed once for all input batches. Each proof still fails
+ * with the same probability as on its own, and the per-proof work (random
+ * inputs, circuit evaluation, proof evaluation and output extraction) is
+ * spread across cores.
+ *
+ * The checks are not merged into a random linear combination: the circuit
+ * is not linear in its inputs, so every circuit evaluation is needed
+ * anyway, and a combined check would no longer tell which proof failed.
+ *
+ * An input batch whose size or input size does not match the first one is
+ * rejected. Throws std::invalid_argument if there are not as many input
+ * batches as proofs.
+ */
+template<typename FieldT>
+batch_verification_stats_t batch_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                                          const std::vector<input_batch_t<FieldT> > &input_batches,
+                                          std::vector<output_batch_t<FieldT> > &output_batches,
+                                          const std::vector<proof_t<FieldT> > &proofs,
+                                          const size_t &num_repetitions = 1);
+
+} // bace
+
+#include "batch_verifier.tcc"
+
+#endif // BATCH_VERIFIER_HPP_
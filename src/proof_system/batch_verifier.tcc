@@ -0,0 +1,105 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for batch verification.
+
+ See batch_verifier.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef BATCH_VERIFIER_TCC_
+#define BATCH_VERIFIER_TCC_
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
+
+namespace bace {
+
+template<typename FieldT>
+batch_verification_stats_t batch_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                                          const std::vector<input_batch_t<FieldT> > &input_batches,
+                                          std::vector<output_batch_t<FieldT> > &output_batches,
+                                          const std::vector<proof_t<FieldT> > &proofs,
+                                          const size_t &num_repetitions)
+{
+    if (input_batches.size() != proofs.size())
+    {
+        throw std::invalid_argument("batch_verifier: one input batch is needed per proof");
+    }
+
+    /* With no random element, any proof would pass */
+    if (num_repetitions == 0) throw std::invalid_argument("batch_verifier: num_repetitions must be positive");
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const size_t num_proofs = proofs.size();
+    batch_verification_stats_t stats;
+    stats.accepted.assign(num_proofs, false);
+    output_batches.assign(num_proofs, output_batch_t<FieldT>());
+
+    if (num_proofs > 0)
+    {
+        /* Setup shared by all proofs */
+        const size_t batch_size = input_batches[0].size();
+        const size_t input_size = get_input_size(input_batches[0]);
+        const size_t column_size = get_column_size(batch_size);
+        const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+        const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+        get_evaluation_domain<FieldT>(column_size); // Cached for the output extractions
+
+        std::vector<FieldT> random_elements(num_repetitions);
+        std::vector<std::vector<FieldT> > weights;
+        for (FieldT &random_element : random_elements)
+        {
+            random_element = FieldT::random_element();
+            weights.emplace_back(evaluate_lagrange_basis(column_size, batch_size, random_element));
+        }
+
+        /* Proofs are independent, and write to disjoint outputs */
+        std::vector<char> accepted(num_proofs, 0);
+#ifdef MULTICORE
+        #pragma omp parallel for schedule(dynamic)
+#endif
+        for (size_t i = 0; i < num_proofs; i++)
+        {
+            const input_batch_t<FieldT> &input_batch = input_batches[i];
+            const proof_t<FieldT> &proof = proofs[i];
+            if (input_batch.size() != batch_size || get_input_size(input_batch) != input_size) continue;
+            if (input_size != compiled_circuit.num_inputs()) continue;
+            if (proof.size() > large_degree) continue;
+
+            /* One proof per thread: the rows are accumulated serially, not in a nested region */
+            std::vector<FieldT> evaluation(num_repetitions * input_size, FieldT::zero());
+            accumulate_column_lde(input_batch, weights, 0, batch_size, evaluation.data());
+            std::vector<input_t<FieldT> > random_inputs(num_repetitions);
+            for (size_t r = 0; r < num_repetitions; r++)
+            {
+                random_inputs[r].assign(evaluation.begin() + r * input_size, evaluation.begin() + (r + 1) * input_size);
+            }
+
+            const std::vector<FieldT> outputs_mine = compiled_circuit.evaluate_outputs(random_inputs)[0];
+            const std::vector<FieldT> outputs_proof = evaluate_polynomial(proof.data(), proof.size(), random_elements);
+            if (outputs_mine == outputs_proof)
+            {
+                extract_output_batch(proof, batch_size, output_batches[i]);
+                accepted[i] = 1;
+            }
+        }
+
+        for (size_t i = 0; i < num_proofs; i++) stats.accepted[i] = (accepted[i] != 0);
+    }
+
+    stats.num_accepted = std::count(stats.accepted.begin(), stats.accepted.end(), true);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.proofs_per_second = (stats.seconds > 0) ? num_proofs / stats.seconds : 0;
+    return stats;
+}
+
+} // bace
+
+#endif // BATCH_VERIFIER_TCC_
@@ -26,10 +26,62 @@ using input_batch_t = std::vector<input_t<FieldT> >;
 template<typename FieldT>
 using output_batch_t = std::vector<FieldT>;
 
+/********************************* MEMORY ************************************/
+
+/* Alignment of the contiguous buffers of field elements (one cache line) */
+const size_t CACHE_LINE_SIZE = 64;
+
+/* Allocator of buffers aligned to CACHE_LINE_SIZE bytes */
+template<typename T>
+struct aligned_allocator_t
+{
+    typedef T value_type;
+
+    aligned_allocator_t() {}
+    template<typename U>
+    aligned_allocator_t(const aligned_allocator_t<U> &) {}
+
+    T *allocate(const size_t n);
+    void deallocate(T *p, const size_t n);
+};
+
+template<typename T, typename U>
+bool operator==(const aligned_allocator_t<T> &, const aligned_allocator_t<U> &) { return true; }
+
+template<typename T, typename U>
+bool operator!=(const aligned_allocator_t<T> &, const aligned_allocator_t<U> &) { return false; }
+
+template<typename T>
+using aligned_vector_t = std::vector<T, aligned_allocator_t<T> >;
+
 /**************************** PROVER / VERIFIER ******************************/
 
+/*
+ * A batch of columns in one contiguous, aligned, column-major buffer. Column
+ * i occupies the column_size elements starting at column_lde[i], so that
+ * column_lde[i][j] is element j of column i, and the columns can be
+ * transformed together by the batched FFTs of fft_domain_t.
+ */
 template<typename FieldT>
-using column_lde_t = std::vector<std::vector<FieldT> >;
+class column_lde_t {
+public:
+    column_lde_t() : _num_columns(0), _column_size(0) {};
+    column_lde_t(const size_t &num_columns, const size_t &column_size);
+
+    FieldT *operator[](const size_t &i);
+    const FieldT *operator[](const size_t &i) const;
+
+    FieldT *data();
+    const FieldT *data() const;
+
+    size_t num_columns() const;
+    size_t column_size() const;
+
+private:
+    size_t _num_columns;
+    size_t _column_size;
+    aligned_vector_t<FieldT> _values;
+};
 
 template<typename FieldT>
 using proof_t = std::vector<FieldT>;
@@ -48,19 +100,140 @@ template<typename FieldT>
 size_t get_input_size(const input_batch_t<FieldT> &input_batch);
 
 /*
- * Returns the column_lde_t of a given input batch in vector form, or an
- * empty vector if there is a mismatch among input sizes.
+ * Returns the column_lde_t of a given input batch, or an empty column_lde_t
+ * if there is a mismatch among input sizes.
  *
  * Given a batch of inputs, consider these to be ordered as rows of inputs.
  * The function computes the column-wise low degree extension by taking
  * the inverse FFT of the columns on a column_size domain.
  *
  * column_lde[i] = IFFT([input_batch[1][i], ... , input_batch[batch_size][i]])
+ *
+ * The rows are moved into column-major order by a cache-blocked transpose,
+ * and all columns are then transformed by one batched inverse FFT.
  */
 template<typename FieldT>
 column_lde_t<FieldT> compute_column_lde(const input_batch_t<FieldT> &input_batch,
                                         const size_t &column_size);
 
+/*
+ * Same as above, writing the column_lde_t into the column-major buffer
+ * column_lde of input_size * column_size elements, in place of a new one.
+ */
+template<typename FieldT>
+void compute_column_lde(const input_batch_t<FieldT> &input_batch,
+                        const size_t &column_size,
+                        FieldT *column_lde);
+
+/*
+ * Returns the values at point of the Lagrange basis polynomials of the
+ * first batch_size points of the column domain, i.e. weights such that any
+ * column of the column_lde_t evaluates at point to
+ *
+ * column(point) = sum_t weights[t] * v_t,
+ *
+ * where v_t is the value of the column at row t of the input batch. Away
+ * from the column domain H = { omega^t }, these are given by the
+ * barycentric formula
+ *
+ * weights[t] = (point^column_size - 1) / column_size * omega^t / (point - omega^t),
+ *
+ * whose inversions are batched into a single one. On the column domain, the
+ * weights select the row at point (or none, for a padding point).
+ */
+template<typename FieldT>
+std::vector<FieldT> evaluate_lagrange_basis(const size_t &column_size,
+                                            const size_t &batch_size,
+                                            const FieldT &point);
+
+/*
+ * Returns the evaluation at point of every column of the column_lde_t of a
+ * given input batch, without computing the column_lde_t itself.
+ *
+ * The weights of evaluate_lagrange_basis() are shared by all columns, and
+ * only the batch_size rows holding inputs contribute, so the columns are
+ * evaluated in one streaming pass over the rows of the batch.
+ */
+template<typename FieldT>
+std::vector<FieldT> evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                        const size_t &column_size,
+                                        const FieldT &point);
+
+/*
+ * Same as above, at several points at once: returns the input_size
+ * evaluations at each of the points. Each row of the batch is read once
+ * and accumulated into the evaluations at all points, so the cost of the
+ * pass over the batch is shared by the points.
+ */
+template<typename FieldT>
+std::vector<input_t<FieldT> > evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                                  const size_t &column_size,
+                                                  const std::vector<FieldT> &points);
+
+/*
+ * Same as above, given the weights of evaluate_lagrange_basis() at each of
+ * the points, which can then be shared by batches of the same batch_size.
+ */
+template<typename FieldT>
+std::vector<input_t<FieldT> > evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                                  const std::vector<std::vector<FieldT> > &weights);
+
+/*
+ * Adds the contribution of rows first, ... , last - 1 of the batch to the
+ * evaluations at each of the points, held as num_points rows of input_size
+ * elements from evaluation. This is the pass of evaluate_column_lde() over
+ * a range of rows, on the calling thread only, for callers that already
+ * run one batch per thread (ex. batch_verifier()).
+ */
+template<typename FieldT>
+void accumulate_column_lde(const input_batch_t<FieldT> &input_batch,
+                           const std::vector<std::vector<FieldT> > &weights,
+                           const size_t &first,
+                           const size_t &last,
+                           FieldT *evaluation);
+
+/*
+ * Computes the output batch carried by a proof, i.e. the evaluations of the
+ * proof polynomial at the points of the column domain that correspond to
+ * the batch_size inputs.
+ *
+ * The column domain is the group of column_size-th roots of unity, on which
+ * the proof polynomial agrees with its remainder modulo X^column_size - 1.
+ * The remainder is obtained by summing the coefficients in strides of
+ * column_size, so the outputs cost O(large_degree) additions and a single
+ * column_size FFT, rather than an FFT over the large domain.
+ */
+template<typename FieldT>
+void extract_output_batch(const proof_t<FieldT> &proof,
+                          const size_t &batch_size,
+                          output_batch_t<FieldT> &output_batch);
+
+/*
+ * Same as above, for the proof_size leading coefficients of a proof held
+ * outside of a proof_t (e.g. a mapped_proof_t), the remaining ones being zero.
+ */
+template<typename FieldT>
+void extract_output_batch(const FieldT *proof,
+                          const size_t &proof_size,
+                          const size_t &batch_size,
+                          output_batch_t<FieldT> &output_batch);
+
+/* Returns the evaluation at point of the polynomial of size coefficients */
+template<typename FieldT>
+FieldT evaluate_polynomial(const FieldT *coefficients,
+                           const size_t &size,
+                           const FieldT &point);
+
+/*
+ * Returns the evaluations at each of the points of the polynomial of size
+ * coefficients, by Horner's rule at all points in a single pass over the
+ * coefficients.
+ */
+template<typename FieldT>
+std::vector<FieldT> evaluate_polynomial(const FieldT *coefficients,
+                                        const size_t &size,
+                                        const std::vector<FieldT> &points);
+
 } // bace
 
 #include "common.tcc"
@@ -13,8 +13,76 @@
 #ifndef COMMON_TCC_
 #define COMMON_TCC_
 
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
 namespace bace {
 
+/* Side of the square tiles of the column transpose */
+const size_t TRANSPOSE_TILE_SIZE = 16;
+
+template<typename T>
+T *aligned_allocator_t<T>::allocate(const size_t n)
+{
+    void *p = nullptr;
+    if (posix_memalign(&p, CACHE_LINE_SIZE, n * sizeof(T)) != 0) throw std::bad_alloc();
+    INSTRUMENT_COUNT(COUNTER_BYTES_ALLOCATED, n * sizeof(T));
+    return static_cast<T*>(p);
+}
+
+template<typename T>
+void aligned_allocator_t<T>::deallocate(T *p, const size_t)
+{
+    free(p);
+}
+
+template<typename FieldT>
+column_lde_t<FieldT>::column_lde_t(const size_t &num_columns, const size_t &column_size) :
+    _num_columns(num_columns), _column_size(column_size), _values(num_columns * column_size, FieldT::zero())
+{
+}
+
+template<typename FieldT>
+FieldT *column_lde_t<FieldT>::operator[](const size_t &i)
+{
+    return this->_values.data() + i * this->_column_size;
+}
+
+template<typename FieldT>
+const FieldT *column_lde_t<FieldT>::operator[](const size_t &i) const
+{
+    return this->_values.data() + i * this->_column_size;
+}
+
+template<typename FieldT>
+FieldT *column_lde_t<FieldT>::data()
+{
+    return this->_values.data();
+}
+
+template<typename FieldT>
+const FieldT *column_lde_t<FieldT>::data() const
+{
+    return this->_values.data();
+}
+
+template<typename FieldT>
+size_t column_lde_t<FieldT>::num_columns() const
+{
+    return this->_num_columns;
+}
+
+template<typename FieldT>
+size_t column_lde_t<FieldT>::column_size() const
+{
+    return this->_column_size;
+}
+
 template<typename FieldT>
 size_t get_input_size(const input_batch_t<FieldT> &input_batch)
 {
@@ -27,23 +95,242 @@ size_t get_input_size(const input_batch_t<FieldT> &input_batch)
 template<typename FieldT>
 column_lde_t<FieldT> compute_column_lde(const input_batch_t<FieldT> &input_batch,
                                         const size_t &column_size)
+{
+    column_lde_t<FieldT> column_lde(get_input_size(input_batch), column_size);
+    compute_column_lde(input_batch, column_size, column_lde.data());
+    return column_lde;
+}
+
+template<typename FieldT>
+void compute_column_lde(const input_batch_t<FieldT> &input_batch,
+                        const size_t &column_size,
+                        FieldT *column_lde)
 {
     const size_t batch_size = input_batch.size();
     const size_t input_size = get_input_size(input_batch);
     const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(column_size);
 
-    column_lde_t<FieldT> column_lde(input_size);
-    for (size_t i = 0; i < input_size; i++)
+    /* Blocked transpose, zeroing the rows from batch_size up to column_size */
+    const size_t tile = TRANSPOSE_TILE_SIZE;
+#ifdef MULTICORE
+    #pragma omp parallel for
+#endif
+    for (size_t i0 = 0; i0 < input_size; i0 += tile)
     {
-        column_lde[i] = std::vector<FieldT>(column_size);
-        for (size_t j = 0; j < batch_size; j++) // Only fill up to batch_size
+        const size_t i1 = std::min(i0 + tile, input_size);
+        for (size_t j0 = 0; j0 < batch_size; j0 += tile)
+        {
+            const size_t j1 = std::min(j0 + tile, batch_size);
+            for (size_t j = j0; j < j1; j++)
+            {
+                const FieldT *row = input_batch[j].data();
+                for (size_t i = i0; i < i1; i++)
+                {
+                    column_lde[i * column_size + j] = row[i];
+                }
+            }
+        }
+        for (size_t i = i0; i < i1; i++)
         {
-            column_lde[i][j] = input_batch[j][i];
+            std::fill(column_lde + i * column_size + batch_size, column_lde + (i + 1) * column_size, FieldT::zero());
         }
-        domain->iFFT(column_lde[i]);
     }
 
-    return column_lde;
+    domain->batch_iFFT(column_lde, input_size);
+}
+
+template<typename FieldT>
+std::vector<FieldT> evaluate_lagrange_basis(const size_t &column_size,
+                                            const size_t &batch_size,
+                                            const FieldT &point)
+{
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(column_size);
+    std::vector<FieldT> weights(batch_size, FieldT::zero());
+
+    /* A point of the column domain selects its row (none for padding) */
+    const FieldT vanishing = (point ^ column_size) - FieldT::one();
+    if (vanishing == FieldT::zero())
+    {
+        FieldT omega_t = FieldT::one();
+        for (size_t t = 0; t < batch_size; t++, omega_t *= domain->omega)
+        {
+            if (omega_t == point)
+            {
+                weights[t] = FieldT::one();
+                break;
+            }
+        }
+        return weights;
+    }
+
+    /* Barycentric weights, with the inversions batched by Montgomery's trick */
+    std::vector<FieldT> omega_powers(batch_size);
+    FieldT omega_t = FieldT::one();
+    FieldT product = FieldT::one();
+    for (size_t t = 0; t < batch_size; t++, omega_t *= domain->omega)
+    {
+        omega_powers[t] = omega_t;
+        weights[t] = product;
+        product *= point - omega_t;
+    }
+
+    FieldT inverse = product.inverse() * vanishing * domain->size_inverse();
+    for (size_t t = batch_size; t-- > 0;)
+    {
+        weights[t] *= inverse * omega_powers[t];
+        inverse *= point - omega_powers[t];
+    }
+    return weights;
+}
+
+template<typename FieldT>
+std::vector<FieldT> evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                        const size_t &column_size,
+                                        const FieldT &point)
+{
+    return evaluate_column_lde(input_batch, column_size, std::vector<FieldT> { point })[0];
+}
+
+template<typename FieldT>
+std::vector<input_t<FieldT> > evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                                  const size_t &column_size,
+                                                  const std::vector<FieldT> &points)
+{
+    std::vector<std::vector<FieldT> > weights;
+    for (const FieldT &point : points)
+    {
+        weights.emplace_back(evaluate_lagrange_basis(column_size, input_batch.size(), point));
+    }
+    return evaluate_column_lde(input_batch, weights);
+}
+
+template<typename FieldT>
+std::vector<input_t<FieldT> > evaluate_column_lde(const input_batch_t<FieldT> &input_batch,
+                                                  const std::vector<std::vector<FieldT> > &weights)
+{
+    const size_t batch_size = input_batch.size();
+    const size_t input_size = get_input_size(input_batch);
+    const size_t num_points = weights.size();
+
+    /* Streaming pass over the rows, one partial sum per column and point */
+    std::vector<FieldT> evaluation(num_points * input_size, FieldT::zero());
+#ifdef MULTICORE
+    #pragma omp parallel
+    {
+        const size_t num_threads = omp_get_num_threads();
+        const size_t thread = omp_get_thread_num();
+        std::vector<FieldT> partial(num_points * input_size, FieldT::zero());
+        accumulate_column_lde(input_batch, weights, thread * batch_size / num_threads,
+                              (thread + 1) * batch_size / num_threads, partial.data());
+
+        #pragma omp critical
+        for (size_t i = 0; i < num_points * input_size; i++)
+        {
+            evaluation[i] += partial[i];
+        }
+    }
+#else
+    accumulate_column_lde(input_batch, weights, 0, batch_size, evaluation.data());
+#endif
+
+    std::vector<input_t<FieldT> > evaluations(num_points);
+    for (size_t r = 0; r < num_points; r++)
+    {
+        evaluations[r].assign(evaluation.begin() + r * input_size, evaluation.begin() + (r + 1) * input_size);
+    }
+    return evaluations;
+}
+
+template<typename FieldT>
+void accumulate_column_lde(const input_batch_t<FieldT> &input_batch,
+                           const std::vector<std::vector<FieldT> > &weights,
+                           const size_t &first,
+                           const size_t &last,
+                           FieldT *evaluation)
+{
+    const size_t input_size = get_input_size(input_batch);
+    const size_t num_points = weights.size();
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, (last - first) * input_size * num_points);
+
+    for (size_t t = first; t < last; t++)
+    {
+        const FieldT *row = input_batch[t].data();
+        for (size_t r = 0; r < num_points; r++)
+        {
+            const FieldT weight = weights[r][t];
+            FieldT *sum = evaluation + r * input_size;
+            for (size_t i = 0; i < input_size; i++)
+            {
+                sum[i] += weight * row[i];
+            }
+        }
+    }
+}
+
+template<typename FieldT>
+void extract_output_batch(const proof_t<FieldT> &proof,
+                          const size_t &batch_size,
+                          output_batch_t<FieldT> &output_batch)
+{
+    extract_output_batch(proof.data(), proof.size(), batch_size, output_batch);
+}
+
+template<typename FieldT>
+void extract_output_batch(const FieldT *proof,
+                          const size_t &proof_size,
+                          const size_t &batch_size,
+                          output_batch_t<FieldT> &output_batch)
+{
+    const size_t column_size = get_column_size(batch_size);
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(column_size);
+
+    output_batch.assign(column_size, FieldT::zero());
+    for (size_t i = 0; i < proof_size; i += column_size)
+    {
+        const size_t count = std::min(column_size, proof_size - i);
+        for (size_t j = 0; j < count; j++)
+        {
+            output_batch[j] += proof[i + j];
+        }
+    }
+
+    domain->FFT(output_batch);
+    output_batch.resize(batch_size);
+}
+
+template<typename FieldT>
+FieldT evaluate_polynomial(const FieldT *coefficients,
+                           const size_t &size,
+                           const FieldT &point)
+{
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, size);
+
+    FieldT result = FieldT::zero();
+    for (size_t i = size; i-- > 0;)
+    {
+        result = result * point + coefficients[i];
+    }
+    return result;
+}
+
+template<typename FieldT>
+std::vector<FieldT> evaluate_polynomial(const FieldT *coefficients,
+                                        const size_t &size,
+                                        const std::vector<FieldT> &points)
+{
+    const size_t num_points = points.size();
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, size * num_points);
+
+    std::vector<FieldT> result(num_points, FieldT::zero());
+    for (size_t i = size; i-- > 0;)
+    {
+        const FieldT coefficient = coefficients[i];
+        for (size_t r = 0; r < num_points; r++)
+        {
+            result[r] = result[r] * points[r] + coefficient;
+        }
+    }
+    return result;
 }
 
 } // bace
@@ -11,26 +11,168 @@
 #ifndef DOMAIN_HPP_
 #define DOMAIN_HPP_
 
+#include <memory>
+#include <vector>
+
 #include "evaluation_domain/evaluation_domain.hpp"
+#include "evaluation_domain/domains/basic_radix2_domain.hpp"
+
+#include "src/proof_system/instrumentation.hpp"
 
 namespace bace {
 
+/******************************** FFT DOMAIN *********************************/
+
+/*
+ * Odd factors k of the domain sizes k * 2^b supported by fft_domain_t, in
+ * order of preference: a size that is reached by several of them uses the
+ * first, as each extra factor adds k multiplications per point.
+ */
+const size_t DOMAIN_RADICES[] = { 1, 3, 5 };
+
+/*
+ * A basic radix-2 domain that precomputes its twiddle factors.
+ *
+ * The libfqfft domain recomputes the powers of omega on every transform.
+ * Here they are computed once, at construction, and stored stage by stage:
+ * the butterflies of the stage of half-length h read the contiguous table
+ * twiddles[h], ... , twiddles[2h - 1], where twiddles[h + j] = omega_{2h}^j.
+ * The inverse transform has its own table built from omega^{-1}.
+ *
+ * Transforms only read the tables, so a single domain can be shared by
+ * concurrent callers.
+ *
+ * The batch_*FFT() functions transform num_columns columns of size m stored
+ * back to back from a, as in column_lde_t. All columns share the twiddle
+ * tables (and, for the coset transform, one table of powers of the coset
+ * shift); the columns are spread across threads, while a single column is
+ * split across threads stage by stage instead.
+ *
+ * A domain of size k * m, for an odd k of DOMAIN_RADICES and a power of
+ * two m, is the union of the k cosets c_i * H, where H is the radix-2
+ * domain of size m (of generator omega, and of size this->m), c_0 = 1 and
+ * c_i = g^i for the multiplicative generator g. Point n of coset i is
+ * domain element i * m + n. A polynomial P of size k * m splits as
+ *
+ * P(x) = P_0(x) + x^m * P_1(x) + ... + x^{(k - 1) * m} * P_{k - 1}(x),
+ *
+ * which agrees on c_i * H with sum_e z_i^e * P_e(x), z_i = c_i^m. So the
+ * transforms over the domain are k coset transforms of size m, and a k x k
+ * Vandermonde system in the z_i per coefficient, which is solved by its
+ * inverse, computed at construction. Unlike a multiplicative subgroup of
+ * order k * m, this needs no k-th root of unity in the field.
+ *
+ * The libfqfft base only describes H, so it is private: its members that
+ * would be wrong for k > 1 (coset transforms, Lagrange and vanishing
+ * polynomials, and the like) are not exposed, and those of the whole domain
+ * are defined here. m and omega remain those of H.
+ */
+template<typename FieldT>
+class fft_domain_t : private libfqfft::basic_radix2_domain<FieldT> {
+public:
+    fft_domain_t(const size_t m);
+
+    using libfqfft::basic_radix2_domain<FieldT>::m;
+    using libfqfft::basic_radix2_domain<FieldT>::omega;
+
+    void FFT(std::vector<FieldT> &a);
+    void iFFT(std::vector<FieldT> &a);
+
+    void batch_FFT(FieldT *a, const size_t &num_columns) const;
+    void batch_iFFT(FieldT *a, const size_t &num_columns) const;
+    void batch_cosetFFT(FieldT *a, const size_t &num_columns, const FieldT &g) const;
+
+    FieldT get_domain_element(const size_t idx);
+    FieldT compute_vanishing_polynomial(const FieldT &t);
+
+    /* Returns the number of points of the domain, radix() * m */
+    size_t size() const;
+
+    /* Returns the odd factor k of the domain size */
+    size_t radix() const;
+
+    /*
+     * The domain is the disjoint union of its cosets of the coset_size-th
+     * roots of unity, for a power of two coset_size dividing m: coset c is
+     * coset_shift(c, coset_size) * { omega_{coset_size}^t }, and its point t is
+     * domain element coset_offset(c, coset_size) + coset_stride(coset_size) * t.
+     * There are size() / coset_size cosets.
+     */
+    FieldT coset_shift(const size_t &c, const size_t &coset_size) const;
+    size_t coset_offset(const size_t &c, const size_t &coset_size) const;
+    size_t coset_stride(const size_t &coset_size) const;
+
+    /* Returns the inverse of the domain size */
+    const FieldT &size_inverse() const;
+
+    /* Returns the number of bytes held by the domain, including its tables */
+    size_t memory_footprint() const;
+
+private:
+    std::vector<FieldT> _twiddles;
+    std::vector<FieldT> _inverse_twiddles;
+    FieldT _size_inverse;
+
+    /* Coset shifts c_i and their inverses, z_i = c_i^m, and the inverse Vandermonde matrix over m */
+    size_t _radix;
+    std::vector<FieldT> _shifts;
+    std::vector<FieldT> _shift_inverses;
+    std::vector<FieldT> _powers;
+    std::vector<FieldT> _vandermonde_inverse;
+
+    void transform(FieldT *a, const std::vector<FieldT> &twiddles) const;
+
+    /* Transforms of the whole domain, on size() values */
+    void forward(FieldT *a) const;
+    void inverse(FieldT *a) const;
+};
+
 template<typename FieldT>
-using domain_t = std::shared_ptr<libfqfft::evaluation_domain<FieldT> >;
+using domain_t = std::shared_ptr<fft_domain_t<FieldT> >;
+
+/******************************* DOMAIN CACHE ********************************/
+
+/* Counters of the process-wide domain cache for one field type */
+struct domain_cache_stats_t
+{
+    size_t hits;
+    size_t misses;
+    size_t num_domains;
+    size_t memory_footprint;
+
+    double hit_rate() const;
+};
 
 /*
- * Returns an evaluation domain given the domain_size.
+ * Returns an evaluation domain given the domain_size, of the form k * 2^b
+ * for k in DOMAIN_RADICES.
  *
  * Our construction makes the assumption that the roots of unity always exist
- * by choosing to use the basic radix-2 domain. This ensures the small domain
- * used to construct the column_lde_t will always be embedded within the
- * large domain. This structure makes it convenient to select the embedded
- * indices of the output on the large domain, as the points will be a power
- * of two apart.
+ * by building every domain on the basic radix-2 domain. This ensures the
+ * small domain used to construct the column_lde_t will always be embedded
+ * within the large domain, in its first coset of the radix-2 domain. This
+ * structure makes it convenient to select the embedded indices of the
+ * output on the large domain, as the points will be a power of two apart.
+ *
+ * Domains are cached process-wide, keyed by field type and domain_size, so
+ * repeated proofs of the same shape never recompute roots of unity or
+ * twiddle factors. The cache is thread-safe, and the returned domain is
+ * shared with every other caller asking for the same size.
  */
 template<typename FieldT>
 domain_t<FieldT> get_evaluation_domain(const size_t &domain_size);
 
+/* Returns the hit rate and memory footprint of the domain cache for FieldT */
+template<typename FieldT>
+domain_cache_stats_t get_domain_cache_stats();
+
+/*
+ * Drops all cached domains for FieldT and resets the counters. Domains
+ * still referenced by callers stay alive until released.
+ */
+template<typename FieldT>
+void clear_domain_cache();
+
 /*
  * Returns the closest previous power of two, or itself if it's a power of two.
  *
@@ -42,16 +184,19 @@ domain_t<FieldT> get_evaluation_domain(const size_t &domain_size);
  */
 unsigned int get_previous_power_of_two(const unsigned int &n);
 
+/* Returns the largest power of two dividing n, the radix-2 part of a domain size */
+size_t get_radix2_size(const size_t &n);
+
 /*
  * Returns the corresponding, embedded index in the large_domain_size for a
  * given index in the small_domain_size.
  *
  * The function assumes the small domain is embedded in the large domain,
  * allowing it to find a corresponding relation in index between the the
- * two domains. This implementation uses the basic radix-2 domain, where
- * the large_domain_size is a factor of the small_domain_size. So the jump
- * between points of interest in the large domain is some distance apart,
- * namely the factor's previous power of two in a radix-2 domain.
+ * two domains. The small domain is a radix-2 domain, which lies in the
+ * first coset of the radix-2 domain of the large domain (see fft_domain_t),
+ * whose size is a multiple of the small_domain_size. So the jump between
+ * points of interest in the large domain is that multiple.
  */
 unsigned int get_embedded_index(const size_t &index,
                                 const size_t &small_domain_size,
@@ -61,19 +206,36 @@ unsigned int get_embedded_index(const size_t &index,
  * Returns the column size given a batch_size.
  *
  * This function extends the batch size to the nearest power of two. This is
- * necessary for constructing a column_lde_t on the radix-2 domain.
+ * necessary for constructing a column_lde_t on the radix-2 domain, which has
+ * at least 2 points, so a batch of a single input is padded to 2.
  */
 size_t get_column_size(const size_t &batch_size);
 
 /*
  * Returns the large_degree domain size given a column_size and circuit degree.
  *
- * This function determines the large_degree domain size by extending the
- * product of the column_size and degree to the nearest power of two. This
- * ensures there exists an embedding of the small domain in the large domain.
+ * The proof polynomial has (column_size - 1) * degree + 1 coefficients, so
+ * this function returns the smallest domain size k * 2^b, for k in
+ * DOMAIN_RADICES, that covers as many points, with 2^b at least column_size.
+ * The latter ensures there exists an embedding of the small domain in the
+ * large domain. Rounding up to a power of two instead would cost up to
+ * twice the points in the FFTs, the evaluations and the proof length.
  */
 size_t get_large_degree(const size_t &column_size, const size_t &degree);
 
+/*
+ * Returns the number of independent verifier checks that bounds the
+ * soundness error by 2^-security_bits, given the large_degree of the proofs.
+ *
+ * A cheating proof differs from the honest one by a nonzero polynomial of
+ * degree below large_degree, so it passes a check at a random element with
+ * probability at most large_degree / |FieldT|. A single check suffices for
+ * the 254-bit fields of libff, while a 64-bit field (see fp64_model_t) needs
+ * a few repetitions for a large security parameter.
+ */
+template<typename FieldT>
+size_t get_num_repetitions(const size_t &large_degree, const size_t &security_bits);
+
 } // bace
 
 #include "domain.tcc"
@@ -13,15 +13,417 @@
 #ifndef DOMAIN_TCC_
 #define DOMAIN_TCC_
 
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
 namespace bace {
 
+/* Largest of DOMAIN_RADICES, and number of coefficients per task of the radix step */
+const size_t MAX_DOMAIN_RADIX = 5;
+const size_t RADIX_BLOCK_SIZE = 1024;
+
+template<typename FieldT>
+fft_domain_t<FieldT>::fft_domain_t(const size_t m) :
+    libfqfft::basic_radix2_domain<FieldT>(get_radix2_size(m)), _radix(m / get_radix2_size(m))
+{
+    assert(std::find(std::begin(DOMAIN_RADICES), std::end(DOMAIN_RADICES), this->_radix) != std::end(DOMAIN_RADICES));
+    assert(this->_radix <= MAX_DOMAIN_RADIX);
+    const size_t n = this->m;
+    const size_t half = n / 2;
+
+    /* Top stage, from which every lower stage is a strided subsequence */
+    this->_twiddles.resize(n);
+    this->_inverse_twiddles.resize(n);
+    const FieldT omega_inverse = this->omega.inverse();
+    FieldT w = FieldT::one();
+    FieldT w_inverse = FieldT::one();
+    for (size_t j = 0; j < half; j++)
+    {
+        this->_twiddles[half + j] = w;
+        this->_inverse_twiddles[half + j] = w_inverse;
+        w *= this->omega;
+        w_inverse *= omega_inverse;
+    }
+    for (size_t h = half / 2; h >= 1; h /= 2)
+    {
+        for (size_t j = 0; j < h; j++)
+        {
+            this->_twiddles[h + j] = this->_twiddles[2 * h + 2 * j];
+            this->_inverse_twiddles[h + j] = this->_inverse_twiddles[2 * h + 2 * j];
+        }
+    }
+
+    this->_size_inverse = FieldT(m).inverse();
+
+    /* Coset shifts c_i = g^i, and z_i = c_i^n, which must be distinct */
+    const size_t k = this->_radix;
+    for (size_t i = 0; i < k; i++)
+    {
+        this->_shifts.emplace_back(i == 0 ? FieldT::one() : this->_shifts[i - 1] * FieldT::multiplicative_generator);
+        this->_shift_inverses.emplace_back(this->_shifts[i].inverse());
+        this->_powers.emplace_back(this->_shifts[i] ^ n);
+        for (size_t j = 0; j < i; j++) assert(this->_powers[i] != this->_powers[j]);
+    }
+
+    /* Inverse of V[i][e] = z_i^e by Gauss-Jordan elimination, scaled by 1/n */
+    std::vector<FieldT> vandermonde(k * k);
+    this->_vandermonde_inverse.assign(k * k, FieldT::zero());
+    for (size_t i = 0; i < k; i++)
+    {
+        vandermonde[i * k] = FieldT::one();
+        for (size_t e = 1; e < k; e++) vandermonde[i * k + e] = vandermonde[i * k + e - 1] * this->_powers[i];
+        this->_vandermonde_inverse[i * k + i] = FieldT(n).inverse();
+    }
+    for (size_t e = 0; e < k; e++)
+    {
+        size_t pivot = e;
+        while (pivot < k && vandermonde[pivot * k + e] == FieldT::zero()) pivot++;
+        if (pivot == k) throw std::runtime_error("fft_domain_t: singular Vandermonde system of the cosets");
+        for (size_t j = 0; j < k; j++)
+        {
+            std::swap(vandermonde[e * k + j], vandermonde[pivot * k + j]);
+            std::swap(this->_vandermonde_inverse[e * k + j], this->_vandermonde_inverse[pivot * k + j]);
+        }
+
+        const FieldT scale = vandermonde[e * k + e].inverse();
+        for (size_t j = 0; j < k; j++)
+        {
+            vandermonde[e * k + j] *= scale;
+            this->_vandermonde_inverse[e * k + j] *= scale;
+        }
+        for (size_t i = 0; i < k; i++)
+        {
+            if (i == e) continue;
+            const FieldT factor = vandermonde[i * k + e];
+            for (size_t j = 0; j < k; j++)
+            {
+                vandermonde[i * k + j] -= factor * vandermonde[e * k + j];
+                this->_vandermonde_inverse[i * k + j] -= factor * this->_vandermonde_inverse[e * k + j];
+            }
+        }
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::transform(FieldT *a, const std::vector<FieldT> &twiddles) const
+{
+    const size_t m = this->m;
+    const size_t log_m = libff::log2(m);
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, get_fft_multiplications(m));
+
+    for (size_t k = 0; k < m; k++)
+    {
+        const size_t rk = libff::bitreverse(k, log_m);
+        if (k < rk) std::swap(a[k], a[rk]);
+    }
+
+    for (size_t h = 1; h < m; h *= 2)
+    {
+        const FieldT *w = &twiddles[h];
+#ifdef MULTICORE
+        #pragma omp parallel for if (m >= (1u << 14))
+#endif
+        for (size_t b = 0; b < m / 2; b++) // Butterfly b of the stage
+        {
+            const size_t j = b & (h - 1);
+            const size_t k = 2 * (b - j) + j;
+            const FieldT t = w[j] * a[k + h];
+            a[k + h] = a[k] - t;
+            a[k] += t;
+        }
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::forward(FieldT *a) const
+{
+    const size_t n = this->m;
+    const size_t k = this->_radix;
+    INSTRUMENT_COUNT(COUNTER_FFTS, 1);
+    INSTRUMENT_COUNT(COUNTER_FFT_ELEMENTS, k * n);
+    if (k == 1)
+    {
+        this->transform(a, this->_twiddles);
+        return;
+    }
+
+    /* Coefficient l of each P_i(c_i x) = sum_e z_i^e P_e(c_i x), in place of those of the P_e */
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, (k + 1) * k * n);
+#ifdef MULTICORE
+    #pragma omp parallel for if (n >= (1u << 14))
+#endif
+    for (size_t l0 = 0; l0 < n; l0 += RADIX_BLOCK_SIZE)
+    {
+        FieldT shift_powers[MAX_DOMAIN_RADIX]; // c_i^l
+        FieldT sums[MAX_DOMAIN_RADIX];
+        for (size_t i = 0; i < k; i++) shift_powers[i] = this->_shifts[i] ^ l0;
+
+        for (size_t l = l0; l < std::min(l0 + RADIX_BLOCK_SIZE, n); l++)
+        {
+            for (size_t i = 0; i < k; i++)
+            {
+                FieldT sum = a[(k - 1) * n + l];
+                for (size_t e = k - 1; e-- > 0;) sum = sum * this->_powers[i] + a[e * n + l];
+                sums[i] = sum * shift_powers[i];
+                shift_powers[i] *= this->_shifts[i];
+            }
+            for (size_t i = 0; i < k; i++) a[i * n + l] = sums[i];
+        }
+    }
+
+    for (size_t i = 0; i < k; i++)
+    {
+        this->transform(a + i * n, this->_twiddles);
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::inverse(FieldT *a) const
+{
+    const size_t n = this->m;
+    const size_t k = this->_radix;
+    INSTRUMENT_COUNT(COUNTER_FFTS, 1);
+    INSTRUMENT_COUNT(COUNTER_FFT_ELEMENTS, k * n);
+    if (k == 1)
+    {
+        this->transform(a, this->_inverse_twiddles);
+        for (size_t j = 0; j < n; j++) a[j] *= this->_size_inverse;
+        INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, n);
+        return;
+    }
+
+    for (size_t i = 0; i < k; i++)
+    {
+        this->transform(a + i * n, this->_inverse_twiddles);
+    }
+
+    /* Coefficient l of each P_e, from coefficient l of each n * P_i(c_i x) */
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, (k + 1) * k * n);
+#ifdef MULTICORE
+    #pragma omp parallel for if (n >= (1u << 14))
+#endif
+    for (size_t l0 = 0; l0 < n; l0 += RADIX_BLOCK_SIZE)
+    {
+        FieldT shift_powers[MAX_DOMAIN_RADIX]; // c_i^{-l}
+        FieldT values[MAX_DOMAIN_RADIX];
+        for (size_t i = 0; i < k; i++) shift_powers[i] = this->_shift_inverses[i] ^ l0;
+
+        for (size_t l = l0; l < std::min(l0 + RADIX_BLOCK_SIZE, n); l++)
+        {
+            for (size_t i = 0; i < k; i++)
+            {
+                values[i] = a[i * n + l] * shift_powers[i];
+                shift_powers[i] *= this->_shift_inverses[i];
+            }
+            for (size_t e = 0; e < k; e++)
+            {
+                FieldT sum = FieldT::zero();
+                for (size_t i = 0; i < k; i++) sum += this->_vandermonde_inverse[e * k + i] * values[i];
+                a[e * n + l] = sum;
+            }
+        }
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::FFT(std::vector<FieldT> &a)
+{
+    assert(a.size() == this->size());
+    this->forward(a.data());
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::iFFT(std::vector<FieldT> &a)
+{
+    assert(a.size() == this->size());
+    this->inverse(a.data());
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::batch_FFT(FieldT *a, const size_t &num_columns) const
+{
+    const size_t m = this->size();
+#ifdef MULTICORE
+    #pragma omp parallel for if (num_columns > 1)
+#endif
+    for (size_t i = 0; i < num_columns; i++)
+    {
+        this->forward(a + i * m);
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::batch_iFFT(FieldT *a, const size_t &num_columns) const
+{
+    const size_t m = this->size();
+#ifdef MULTICORE
+    #pragma omp parallel for if (num_columns > 1)
+#endif
+    for (size_t i = 0; i < num_columns; i++)
+    {
+        this->inverse(a + i * m);
+    }
+}
+
+template<typename FieldT>
+void fft_domain_t<FieldT>::batch_cosetFFT(FieldT *a, const size_t &num_columns, const FieldT &g) const
+{
+    const size_t m = this->size();
+    std::vector<FieldT> shift(m);
+    shift[0] = FieldT::one();
+    for (size_t j = 1; j < m; j++) shift[j] = shift[j - 1] * g;
+    INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, (num_columns + 1) * m);
+
+#ifdef MULTICORE
+    #pragma omp parallel for if (num_columns > 1)
+#endif
+    for (size_t i = 0; i < num_columns; i++)
+    {
+        FieldT *column = a + i * m;
+        for (size_t j = 1; j < m; j++) column[j] *= shift[j];
+        this->forward(column);
+    }
+}
+
+template<typename FieldT>
+FieldT fft_domain_t<FieldT>::get_domain_element(const size_t idx)
+{
+    return this->_shifts[idx / this->m] * (this->omega ^ (idx % this->m));
+}
+
+template<typename FieldT>
+FieldT fft_domain_t<FieldT>::compute_vanishing_polynomial(const FieldT &t)
+{
+    const FieldT t_m = t ^ this->m;
+    FieldT result = FieldT::one();
+    for (const FieldT &z : this->_powers) result *= t_m - z;
+    return result;
+}
+
+template<typename FieldT>
+size_t fft_domain_t<FieldT>::size() const
+{
+    return this->_radix * this->m;
+}
+
+template<typename FieldT>
+size_t fft_domain_t<FieldT>::radix() const
+{
+    return this->_radix;
+}
+
+template<typename FieldT>
+FieldT fft_domain_t<FieldT>::coset_shift(const size_t &c, const size_t &coset_size) const
+{
+    const size_t stride = this->coset_stride(coset_size);
+    return this->_shifts[c / stride] * (this->omega ^ (c % stride));
+}
+
+template<typename FieldT>
+size_t fft_domain_t<FieldT>::coset_offset(const size_t &c, const size_t &coset_size) const
+{
+    const size_t stride = this->coset_stride(coset_size);
+    return (c / stride) * this->m + c % stride;
+}
+
+template<typename FieldT>
+size_t fft_domain_t<FieldT>::coset_stride(const size_t &coset_size) const
+{
+    assert(coset_size <= this->m && this->m % coset_size == 0);
+    return this->m / coset_size;
+}
+
+template<typename FieldT>
+const FieldT &fft_domain_t<FieldT>::size_inverse() const
+{
+    return this->_size_inverse;
+}
+
+template<typename FieldT>
+size_t fft_domain_t<FieldT>::memory_footprint() const
+{
+    const size_t num_elements = this->_twiddles.capacity() + this->_inverse_twiddles.capacity() +
+        this->_shifts.capacity() + this->_shift_inverses.capacity() + this->_powers.capacity() +
+        this->_vandermonde_inverse.capacity();
+    return sizeof(*this) + num_elements * sizeof(FieldT);
+}
+
+inline double domain_cache_stats_t::hit_rate() const
+{
+    const size_t lookups = this->hits + this->misses;
+    return lookups == 0 ? 0 : (double) this->hits / lookups;
+}
+
+/* Process-wide domain cache, one per field type */
+template<typename FieldT>
+struct domain_cache_t
+{
+    std::mutex mutex;
+    std::map<size_t, domain_t<FieldT> > domains;
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+template<typename FieldT>
+domain_cache_t<FieldT> &get_domain_cache()
+{
+    static domain_cache_t<FieldT> cache;
+    return cache;
+}
+
 template<typename FieldT>
 domain_t<FieldT> get_evaluation_domain(const size_t &domain_size)
 {
-    return domain_t<FieldT>(new libfqfft::basic_radix2_domain<FieldT>(domain_size));
+    domain_cache_t<FieldT> &cache = get_domain_cache<FieldT>();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    const auto it = cache.domains.find(domain_size);
+    if (it != cache.domains.end())
+    {
+        cache.hits++;
+        return it->second;
+    }
+
+    cache.misses++;
+    const domain_t<FieldT> domain(new fft_domain_t<FieldT>(domain_size));
+    cache.domains.emplace(domain_size, domain);
+    return domain;
 }
 
-unsigned int get_previous_power_of_two(const unsigned int &n)
+template<typename FieldT>
+domain_cache_stats_t get_domain_cache_stats()
+{
+    domain_cache_t<FieldT> &cache = get_domain_cache<FieldT>();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    domain_cache_stats_t stats;
+    stats.hits = cache.hits;
+    stats.misses = cache.misses;
+    stats.num_domains = cache.domains.size();
+    stats.memory_footprint = 0;
+    for (const auto &entry : cache.domains)
+    {
+        stats.memory_footprint += entry.second->memory_footprint();
+    }
+    return stats;
+}
+
+template<typename FieldT>
+void clear_domain_cache()
+{
+    domain_cache_t<FieldT> &cache = get_domain_cache<FieldT>();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    cache.domains.clear();
+    cache.hits = 0;
+    cache.misses = 0;
+}
+
+inline unsigned int get_previous_power_of_two(const unsigned int &n)
 {
     uint32_t p = n;
 
@@ -35,23 +437,45 @@ unsigned int get_previous_power_of_two(const unsigned int &n)
     return p;
 }
 
-unsigned int get_embedded_index(const size_t &index,
-                                const size_t &small_domain_size,
-                                const size_t &large_domain_size)
+inline size_t get_radix2_size(const size_t &n)
 {
-    const unsigned int embedding_factor = large_domain_size / small_domain_size;
-    const unsigned int jump = get_previous_power_of_two(embedding_factor);
+    return n & (~n + 1);
+}
+
+inline unsigned int get_embedded_index(const size_t &index,
+                                       const size_t &small_domain_size,
+                                       const size_t &large_domain_size)
+{
+    const unsigned int jump = get_radix2_size(large_domain_size) / small_domain_size;
     return index * jump;
 }
 
-size_t get_column_size(const size_t &batch_size)
+inline size_t get_column_size(const size_t &batch_size)
 {
-    return libff::get_power_of_two(batch_size);
+    return std::max<size_t>(2, libff::get_power_of_two(batch_size));
 }
 
-size_t get_large_degree(const size_t &column_size, const size_t &degree)
+inline size_t get_large_degree(const size_t &column_size, const size_t &degree)
+{
+    const size_t num_points = (column_size - 1) * degree + 1;
+    size_t large_degree = 0;
+    for (const size_t &k : DOMAIN_RADICES)
+    {
+        size_t radix2_size = column_size;
+        while (k * radix2_size < num_points) radix2_size *= 2;
+        if (large_degree == 0 || k * radix2_size < large_degree) large_degree = k * radix2_size;
+    }
+    return large_degree;
+}
+
+template<typename FieldT>
+size_t get_num_repetitions(const size_t &large_degree, const size_t &security_bits)
 {
-    return libff::get_power_of_two(column_size * degree);
+    /* Each check contributes size_in_bits() - 1 - log2(large_degree) bits */
+    const size_t degree_bits = libff::log2(large_degree);
+    assert(FieldT::size_in_bits() > degree_bits + 1);
+    const size_t bits_per_check = FieldT::size_in_bits() - 1 - degree_bits;
+    return std::max<size_t>(1, (security_bits + bits_per_check - 1) / bits_per_check);
 }
 
 } // bace
@@ -0,0 +1,107 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for phase instrumentation.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef INSTRUMENTATION_HPP_
+#define INSTRUMENTATION_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace bace {
+
+/*
+ * Instrumentation of the prover and verifier.
+ *
+ * When compiled with INSTRUMENTATION defined (cmake -DINSTRUMENTATION=ON),
+ * the prover, the verifier and the circuit evaluations record the time spent
+ * in each phase, and count FFTs, field multiplications, gates evaluated and
+ * bytes allocated, into process-wide counters read by
+ * get_instrumentation_stats(). A phase callback, if set, is also called at
+ * the end of each phase, as a hook for external metrics.
+ *
+ * Otherwise, the INSTRUMENT_* macros below expand to nothing, and no
+ * instrumentation code is compiled in. The functions of this file remain
+ * available, and report zeros.
+ *
+ * Counters are updated once per phase or per block of work, never per field
+ * operation, and are safe to update from concurrent threads. Multiplication
+ * counts are those of the algorithms (ex. m/2 * log2(m) per FFT of size m),
+ * not of the field implementation.
+ */
+
+enum phase_t {
+    PHASE_COLUMN_LDE,        // Prover: interpolation of the input columns
+    PHASE_COSET_FFT,         // Prover: extension of the columns to each coset
+    PHASE_COSET_EVALUATION,  // Prover: circuit evaluation on each coset
+    PHASE_PROOF_IFFT,        // Prover: interpolation of the proof
+    PHASE_VERIFY_LDE,        // Verifier: evaluation of the columns at the random points
+    PHASE_VERIFY_CIRCUIT,    // Verifier: circuit evaluation at the random points
+    PHASE_VERIFY_PROOF,      // Verifier: evaluation of the proof at the random points
+    PHASE_EXTRACT_OUTPUT,    // Verifier: extraction of the output batch
+    NUM_PHASES
+};
+
+enum counter_t {
+    COUNTER_FFTS,                  // Transforms, counting each column of a batch
+    COUNTER_FFT_ELEMENTS,          // Sum of the transform sizes
+    COUNTER_FIELD_MULTIPLICATIONS,
+    COUNTER_GATES_EVALUATED,       // Gates, times the points they are evaluated on
+    COUNTER_BYTES_ALLOCATED,       // Column, coset and proof buffers
+    NUM_COUNTERS
+};
+
+struct instrumentation_stats_t
+{
+    double seconds[NUM_PHASES];
+    uint64_t calls[NUM_PHASES];
+    uint64_t counters[NUM_COUNTERS];
+};
+
+/* Called with the phase and its duration in seconds, possibly from concurrent threads */
+typedef std::function<void(const phase_t &phase, const double &seconds)> phase_callback_t;
+
+typedef std::chrono::steady_clock::time_point phase_start_t;
+
+const char *get_phase_name(const phase_t &phase);
+const char *get_counter_name(const counter_t &counter);
+
+/* Returns whether instrumentation is compiled in */
+bool is_instrumented();
+
+instrumentation_stats_t get_instrumentation_stats();
+void reset_instrumentation_stats();
+
+/* Sets the callback of the end of each phase (an empty callback removes it) */
+void set_phase_callback(const phase_callback_t &callback);
+
+/* Records a phase started at start, and ending now */
+void record_phase(const phase_t &phase, const phase_start_t &start);
+
+void record_count(const counter_t &counter, const uint64_t &count);
+
+/* Returns the number of multiplications of an FFT of size m */
+uint64_t get_fft_multiplications(const size_t &m);
+
+#ifdef INSTRUMENTATION
+#define INSTRUMENT_START(start) const bace::phase_start_t start = std::chrono::steady_clock::now()
+#define INSTRUMENT_STOP(start, phase) bace::record_phase(phase, start)
+#define INSTRUMENT_COUNT(counter, count) bace::record_count(counter, count)
+#else
+#define INSTRUMENT_START(start)
+#define INSTRUMENT_STOP(start, phase)
+#define INSTRUMENT_COUNT(counter, count)
+#endif
+
+} // bace
+
+#include "instrumentation.tcc"
+
+#endif // INSTRUMENTATION_HPP_
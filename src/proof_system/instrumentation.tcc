@@ -0,0 +1,125 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for phase instrumentation.
+
+ See instrumentation.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef INSTRUMENTATION_TCC_
+#define INSTRUMENTATION_TCC_
+
+#include <atomic>
+#include <mutex>
+
+namespace bace {
+
+/* Process-wide counters, with phase durations in nanoseconds */
+struct instrumentation_state_t
+{
+    std::atomic<uint64_t> nanoseconds[NUM_PHASES];
+    std::atomic<uint64_t> calls[NUM_PHASES];
+    std::atomic<uint64_t> counters[NUM_COUNTERS];
+
+    std::mutex callback_mutex;
+    phase_callback_t callback;
+    std::atomic<bool> has_callback;
+};
+
+/* Zero-initialized, as a static */
+inline instrumentation_state_t &get_instrumentation_state()
+{
+    static instrumentation_state_t state;
+    return state;
+}
+
+inline const char *get_phase_name(const phase_t &phase)
+{
+    static const char *names[NUM_PHASES] = {
+        "column_lde", "coset_fft", "coset_evaluation", "proof_ifft",
+        "verify_lde", "verify_circuit", "verify_proof", "extract_output"
+    };
+    return names[phase];
+}
+
+inline const char *get_counter_name(const counter_t &counter)
+{
+    static const char *names[NUM_COUNTERS] = {
+        "ffts", "fft_elements", "field_multiplications", "gates_evaluated", "bytes_allocated"
+    };
+    return names[counter];
+}
+
+inline bool is_instrumented()
+{
+#ifdef INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline instrumentation_stats_t get_instrumentation_stats()
+{
+    instrumentation_state_t &state = get_instrumentation_state();
+
+    instrumentation_stats_t stats;
+    for (size_t i = 0; i < NUM_PHASES; i++)
+    {
+        stats.seconds[i] = state.nanoseconds[i] * 1e-9;
+        stats.calls[i] = state.calls[i];
+    }
+    for (size_t i = 0; i < NUM_COUNTERS; i++) stats.counters[i] = state.counters[i];
+    return stats;
+}
+
+inline void reset_instrumentation_stats()
+{
+    instrumentation_state_t &state = get_instrumentation_state();
+    for (size_t i = 0; i < NUM_PHASES; i++) state.nanoseconds[i] = state.calls[i] = 0;
+    for (size_t i = 0; i < NUM_COUNTERS; i++) state.counters[i] = 0;
+}
+
+inline void set_phase_callback(const phase_callback_t &callback)
+{
+    instrumentation_state_t &state = get_instrumentation_state();
+    std::lock_guard<std::mutex> lock(state.callback_mutex);
+    state.callback = callback;
+    state.has_callback = (bool) callback;
+}
+
+inline void record_phase(const phase_t &phase, const phase_start_t &start)
+{
+    const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    instrumentation_state_t &state = get_instrumentation_state();
+    state.nanoseconds[phase] += nanoseconds;
+    state.calls[phase]++;
+
+    if (state.has_callback)
+    {
+        std::lock_guard<std::mutex> lock(state.callback_mutex);
+        if (state.callback) state.callback(phase, nanoseconds * 1e-9);
+    }
+}
+
+inline void record_count(const counter_t &counter, const uint64_t &count)
+{
+    get_instrumentation_state().counters[counter] += count;
+}
+
+inline uint64_t get_fft_multiplications(const size_t &m)
+{
+    uint64_t log_m = 0;
+    while ((size_t(1) << log_m) < m) log_m++;
+    return m / 2 * log_m;
+}
+
+} // bace
+
+#endif // INSTRUMENTATION_TCC_
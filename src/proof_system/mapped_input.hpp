@@ -0,0 +1,72 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for memory-mapped input batches.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef MAPPED_INPUT_HPP_
+#define MAPPED_INPUT_HPP_
+
+#include <string>
+
+#include "src/common/binary_format.hpp"
+#include "src/common/mapped_file.hpp"
+#include "src/proof_system/common.hpp"
+
+namespace bace {
+
+/*
+ * An input batch backed by a memory-mapped, column-major binary file.
+ *
+ * The file is an input batch in the format of binary_format.hpp: a header,
+ * followed by the input_size columns of the batch, each column holding the
+ * batch_size raw field elements
+ * [input_batch[1][i], ... , input_batch[batch_size][i]]. Columns are read
+ * straight from the mapping, so the batch is never materialized in memory.
+ *
+ * The header and the columns are checked against the checksum when the file
+ * is opened, which throws std::runtime_error on a mismatch, so a corrupted
+ * batch is never proved. The check reads the file once, column by column,
+ * dropping each column from the resident set once read, so it stays within
+ * the memory budget of the streaming prover.
+ */
+template<typename FieldT>
+class mapped_input_batch_t {
+public:
+    mapped_input_batch_t(const std::string &path);
+
+    /* Returns the batch_size elements of column i */
+    const FieldT *column(const size_t &i) const;
+
+    /* Hints that columns [begin, end) are about to be read */
+    void will_need(const size_t &begin, const size_t &end) const;
+
+    /* Drops columns [begin, end) from the resident set */
+    void dont_need(const size_t &begin, const size_t &end) const;
+
+    size_t batch_size() const;
+    size_t input_size() const;
+
+    /* Returns whether the header and the columns match the checksum of the header */
+    bool has_valid_checksum() const;
+
+private:
+    mapped_file_t _file;
+    serialization_header_t _header;
+    const FieldT *_columns;
+};
+
+/* Writes an input batch to path, in the format read by mapped_input_batch_t */
+template<typename FieldT>
+void write_mapped_input_batch(const std::string &path,
+                              const input_batch_t<FieldT> &input_batch);
+
+} // bace
+
+#include "mapped_input.tcc"
+
+#endif // MAPPED_INPUT_HPP_
@@ -0,0 +1,116 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for memory-mapped input batches.
+
+ See mapped_input.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef MAPPED_INPUT_TCC_
+#define MAPPED_INPUT_TCC_
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace bace {
+
+template<typename FieldT>
+mapped_input_batch_t<FieldT>::mapped_input_batch_t(const std::string &path) :
+    _file(path), _header(read_header<FieldT>(_file, SERIALIZED_INPUT_BATCH, path))
+{
+    if (this->_header.num_elements != this->_header.batch_size * this->_header.input_size)
+    {
+        throw std::runtime_error("mapped_input_batch_t: inconsistent header in " + path);
+    }
+    this->_columns = reinterpret_cast<const FieldT*>(this->_file.data() + sizeof(serialization_header_t));
+    if (!this->has_valid_checksum())
+    {
+        throw std::runtime_error("mapped_input_batch_t: checksum mismatch in " + path);
+    }
+}
+
+template<typename FieldT>
+const FieldT *mapped_input_batch_t<FieldT>::column(const size_t &i) const
+{
+    return this->_columns + i * this->_header.batch_size;
+}
+
+template<typename FieldT>
+void mapped_input_batch_t<FieldT>::will_need(const size_t &begin, const size_t &end) const
+{
+    const size_t column_bytes = this->_header.batch_size * sizeof(FieldT);
+    this->_file.will_need(sizeof(serialization_header_t) + begin * column_bytes, (end - begin) * column_bytes);
+}
+
+template<typename FieldT>
+void mapped_input_batch_t<FieldT>::dont_need(const size_t &begin, const size_t &end) const
+{
+    const size_t column_bytes = this->_header.batch_size * sizeof(FieldT);
+    this->_file.dont_need(sizeof(serialization_header_t) + begin * column_bytes, (end - begin) * column_bytes);
+}
+
+template<typename FieldT>
+size_t mapped_input_batch_t<FieldT>::batch_size() const
+{
+    return this->_header.batch_size;
+}
+
+template<typename FieldT>
+size_t mapped_input_batch_t<FieldT>::input_size() const
+{
+    return this->_header.input_size;
+}
+
+template<typename FieldT>
+bool mapped_input_batch_t<FieldT>::has_valid_checksum() const
+{
+    /* Column by column, as written, each column leaving the resident set once read */
+    const size_t column_bytes = this->_header.batch_size * sizeof(FieldT);
+    uint64_t checksum = get_header_checksum(this->_header);
+    for (size_t i = 0; i < this->_header.input_size; i++)
+    {
+        this->will_need(i, i + 1);
+        checksum = get_checksum(reinterpret_cast<const char*>(this->column(i)), column_bytes, checksum);
+        this->dont_need(i, i + 1);
+    }
+    return checksum == this->_header.checksum;
+}
+
+template<typename FieldT>
+void write_mapped_input_batch(const std::string &path,
+                              const input_batch_t<FieldT> &input_batch)
+{
+    const size_t batch_size = input_batch.size();
+    const size_t input_size = get_input_size(input_batch);
+    serialization_header_t header = get_header<FieldT>(SERIALIZED_INPUT_BATCH);
+    header.batch_size = batch_size;
+    header.input_size = input_size;
+    header.column_size = get_column_size(batch_size);
+    header.num_elements = batch_size * input_size;
+    header.checksum = get_header_checksum(header);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) throw std::runtime_error("write_mapped_input_batch: cannot open " + path);
+
+    /* The header is rewritten once the checksum of the columns is known */
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    std::vector<FieldT> column(batch_size);
+    for (size_t i = 0; i < input_size && ok; i++)
+    {
+        for (size_t j = 0; j < batch_size; j++) column[j] = input_batch[j][i];
+        header.checksum = get_checksum(reinterpret_cast<const char*>(column.data()), batch_size * sizeof(FieldT), header.checksum);
+        ok = fwrite(column.data(), sizeof(FieldT), batch_size, file) == batch_size;
+    }
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+
+    if (fclose(file) != 0 || !ok) throw std::runtime_error("write_mapped_input_batch: cannot write " + path);
+}
+
+} // bace
+
+#endif // MAPPED_INPUT_TCC_
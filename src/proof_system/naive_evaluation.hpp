@@ -27,6 +27,15 @@ void naive_evaluate(const arithmetic_circuit_t<FieldT> &circuit,
                     const input_batch_t<FieldT> &input_batch,
                     output_batch_t<FieldT> &output_batch);
 
+/*
+ * Performs the direct evaluation of an input batch on several circuits,
+ * and constructs one batch of outputs per output of the circuits, in order.
+ */
+template<typename FieldT>
+void naive_evaluate(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+                    const input_batch_t<FieldT> &input_batch,
+                    std::vector<output_batch_t<FieldT> > &output_batches);
+
 } // bace
 
 #include "naive_evaluation.tcc"
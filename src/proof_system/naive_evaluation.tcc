@@ -20,6 +20,7 @@
 #include "polynomial_arithmetic/naive_evaluate.hpp"
 
 #include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
 
 namespace bace {
 
@@ -29,11 +30,39 @@ void naive_evaluate(const arithmetic_circuit_t<FieldT> &circuit,
                     output_batch_t<FieldT> &output_batch)
 {
     const size_t batch_size = input_batch.size();
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    std::vector<FieldT> scratch = compiled_circuit.get_scratch();
 
     output_batch.resize(batch_size);
     for (size_t i = 0; i < batch_size; i++)
     {
-        output_batch[i] = circuit.evaluate(input_batch[i]);
+        output_batch[i] = compiled_circuit.evaluate(input_batch[i], scratch);
+    }
+}
+
+template<typename FieldT>
+void naive_evaluate(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+                    const input_batch_t<FieldT> &input_batch,
+                    std::vector<output_batch_t<FieldT> > &output_batches)
+{
+    const size_t batch_size = input_batch.size();
+
+    output_batches.clear();
+    for (const arithmetic_circuit_t<FieldT> &circuit : circuits)
+    {
+        const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+        std::vector<FieldT> scratch = compiled_circuit.get_scratch();
+
+        const size_t first = output_batches.size();
+        output_batches.resize(first + compiled_circuit.num_outputs(), output_batch_t<FieldT>(batch_size));
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            const std::vector<FieldT> outputs = compiled_circuit.evaluate_outputs(input_batch[i], scratch);
+            for (size_t k = 0; k < outputs.size(); k++)
+            {
+                output_batches[first + k][i] = outputs[k];
+            }
+        }
     }
 }
 
@@ -0,0 +1,86 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for NUMA placement of threads and buffers.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef NUMA_HPP_
+#define NUMA_HPP_
+
+#include <cstddef>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+namespace bace {
+
+/*
+ * Where the pages of a buffer go on a NUMA machine:
+ *
+ * - PLACEMENT_NAIVE leaves each page on the node of the first thread that
+ *   writes it, often the thread that allocated the buffer;
+ * - PLACEMENT_LOCAL pins the threads, and has each thread write the part of
+ *   the buffer it works on first, so that the part is local to its node;
+ * - PLACEMENT_INTERLEAVED spreads the pages round-robin over the nodes, which
+ *   evens out the bandwidth when the access pattern is not known.
+ */
+enum memory_placement_t { PLACEMENT_NAIVE, PLACEMENT_LOCAL, PLACEMENT_INTERLEAVED };
+
+/* Returns the name of the placement, as taken by get_memory_placement() */
+std::string get_placement_name(const memory_placement_t &placement);
+
+/* Returns the placement of the given name, throwing std::invalid_argument if there is none */
+memory_placement_t get_memory_placement(const std::string &name);
+
+/*
+ * Returns the CPUs of each online NUMA node, among those the process may run
+ * on, as read from /sys/devices/system/node. A machine without NUMA (or
+ * without that directory) is a single node of all allowed CPUs.
+ */
+std::vector<std::vector<int> > get_numa_cpus();
+
+/*
+ * Sets the CPU affinity of the threads of the OpenMP team. For
+ * PLACEMENT_LOCAL and PLACEMENT_INTERLEAVED, thread t of T is pinned to the
+ * CPU at t / T of the CPUs listed node by node, so the consecutive threads
+ * of a node get the consecutive iterations of a static schedule. For
+ * PLACEMENT_NAIVE, the threads are allowed back on all the CPUs the process
+ * started with. Returns false if the affinity could not be set.
+ *
+ * The OpenMP runtime keeps its threads across parallel regions of the same
+ * size, so the affinity lasts until the number of threads changes.
+ */
+bool pin_threads(const memory_placement_t &placement);
+
+/* Returns the CPU affinity of each thread of the OpenMP team, by thread number */
+std::vector<cpu_set_t> get_thread_affinity();
+
+/*
+ * Sets the CPU affinity of each thread of the OpenMP team to the one of the
+ * same number in affinity, as returned by get_thread_affinity(), threads
+ * beyond it being allowed on all the CPUs the process started with. Returns
+ * false if the affinity could not be set.
+ */
+bool set_thread_affinity(const std::vector<cpu_set_t> &affinity);
+
+/*
+ * Applies placement to the size bytes from data, which must be page-aligned
+ * and not yet written (ex. a fresh arena_t). For PLACEMENT_LOCAL, the buffer
+ * is split into num_parts equal parts (ex. its columns), which are zeroed by
+ * the threads that a static schedule over the parts gives them to, so each
+ * page is first touched on the node that later works on it.
+ * PLACEMENT_INTERLEAVED sets an interleaving policy on the range (mbind()).
+ * Returns false if the policy could not be applied, in which case pages are
+ * placed as for PLACEMENT_NAIVE.
+ */
+bool place_memory(char *data, const size_t &size, const size_t &num_parts, const memory_placement_t &placement);
+
+} // bace
+
+#include "numa.tcc"
+
+#endif // NUMA_HPP_
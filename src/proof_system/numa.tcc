@@ -0,0 +1,229 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for NUMA placement of threads and buffers.
+
+ See numa.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef NUMA_TCC_
+#define NUMA_TCC_
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace bace {
+
+/* Memory policy of mbind(), from linux/mempolicy.h */
+const int NUMA_MPOL_INTERLEAVE = 3;
+
+inline std::string get_placement_name(const memory_placement_t &placement)
+{
+    switch (placement)
+    {
+        case PLACEMENT_LOCAL: return "local";
+        case PLACEMENT_INTERLEAVED: return "interleaved";
+        default: return "naive";
+    }
+}
+
+inline memory_placement_t get_memory_placement(const std::string &name)
+{
+    for (const memory_placement_t &placement : { PLACEMENT_NAIVE, PLACEMENT_LOCAL, PLACEMENT_INTERLEAVED })
+    {
+        if (get_placement_name(placement) == name) return placement;
+    }
+    throw std::invalid_argument("get_memory_placement(): unknown placement " + name);
+}
+
+/* Parses a list of ranges of the sysfs format, ex. "0-3,8-11" */
+inline std::vector<int> parse_cpu_list(const std::string &list)
+{
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        const int first = atoi(range.substr(0, dash).c_str());
+        const int last = (dash == std::string::npos) ? first : atoi(range.substr(dash + 1).c_str());
+        for (int value = first; value <= last; value++) values.emplace_back(value);
+    }
+    return values;
+}
+
+/* The CPUs the process may run on, as of the first call */
+inline const cpu_set_t &get_process_cpus()
+{
+    static const cpu_set_t cpus = []() {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        sched_getaffinity(0, sizeof(cpus), &cpus);
+        return cpus;
+    }();
+    return cpus;
+}
+
+inline std::vector<std::vector<int> > get_numa_cpus()
+{
+    const cpu_set_t &allowed = get_process_cpus();
+    std::vector<std::vector<int> > nodes;
+
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string line;
+    if (online && std::getline(online, line))
+    {
+        for (const int &node : parse_cpu_list(line))
+        {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string cpus;
+            if (!cpulist || !std::getline(cpulist, cpus)) continue;
+
+            std::vector<int> node_cpus;
+            for (const int &cpu : parse_cpu_list(cpus))
+            {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) node_cpus.emplace_back(cpu);
+            }
+            if (!node_cpus.empty()) nodes.emplace_back(node_cpus);
+        }
+    }
+
+    if (nodes.empty())
+    {
+        nodes.emplace_back();
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed)) nodes.back().emplace_back(cpu);
+        }
+    }
+    return nodes;
+}
+
+inline bool pin_threads(const memory_placement_t &placement)
+{
+    const cpu_set_t process_cpus = get_process_cpus();
+    std::vector<int> cpus;
+    for (const std::vector<int> &node : get_numa_cpus())
+    {
+        cpus.insert(cpus.end(), node.begin(), node.end());
+    }
+    if (cpus.empty()) return false;
+
+    bool pinned = true;
+#ifdef MULTICORE
+    #pragma omp parallel reduction(&&: pinned)
+#endif
+    {
+#ifdef MULTICORE
+        const size_t thread = omp_get_thread_num();
+        const size_t num_threads = omp_get_num_threads();
+#else
+        const size_t thread = 0;
+        const size_t num_threads = 1;
+#endif
+        cpu_set_t affinity = process_cpus;
+        if (placement != PLACEMENT_NAIVE)
+        {
+            CPU_ZERO(&affinity);
+            CPU_SET(cpus[thread * cpus.size() / num_threads], &affinity);
+        }
+        pinned = (sched_setaffinity(0, sizeof(affinity), &affinity) == 0);
+    }
+    return pinned;
+}
+
+inline std::vector<cpu_set_t> get_thread_affinity()
+{
+#ifdef MULTICORE
+    std::vector<cpu_set_t> affinity(omp_get_max_threads());
+    #pragma omp parallel
+#else
+    std::vector<cpu_set_t> affinity(1);
+#endif
+    {
+#ifdef MULTICORE
+        const size_t thread = omp_get_thread_num();
+#else
+        const size_t thread = 0;
+#endif
+        if (thread < affinity.size())
+        {
+            CPU_ZERO(&affinity[thread]);
+            sched_getaffinity(0, sizeof(cpu_set_t), &affinity[thread]);
+        }
+    }
+    return affinity;
+}
+
+inline bool set_thread_affinity(const std::vector<cpu_set_t> &affinity)
+{
+    const cpu_set_t process_cpus = get_process_cpus();
+    bool set = true;
+#ifdef MULTICORE
+    #pragma omp parallel reduction(&&: set)
+#endif
+    {
+#ifdef MULTICORE
+        const size_t thread = omp_get_thread_num();
+#else
+        const size_t thread = 0;
+#endif
+        const cpu_set_t &cpus = (thread < affinity.size()) ? affinity[thread] : process_cpus;
+        set = (sched_setaffinity(0, sizeof(cpus), &cpus) == 0);
+    }
+    return set;
+}
+
+inline bool place_memory(char *data, const size_t &size, const size_t &num_parts, const memory_placement_t &placement)
+{
+    if (size == 0) return true;
+
+    if (placement == PLACEMENT_INTERLEAVED)
+    {
+        /* One bit per online node, read back from the node lists */
+        unsigned long node_mask = 0;
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string line;
+        if (online && std::getline(online, line))
+        {
+            for (const int &node : parse_cpu_list(line))
+            {
+                if (node < (int) (8 * sizeof(node_mask))) node_mask |= 1UL << node;
+            }
+        }
+        if (node_mask == 0) node_mask = 1;
+        return syscall(SYS_mbind, data, size, NUMA_MPOL_INTERLEAVE, &node_mask, 8 * sizeof(node_mask) + 1, 0) == 0;
+    }
+
+    if (placement == PLACEMENT_LOCAL && num_parts > 0)
+    {
+#ifdef MULTICORE
+        #pragma omp parallel for schedule(static)
+#endif
+        for (size_t p = 0; p < num_parts; p++)
+        {
+            const size_t begin = p * size / num_parts;
+            const size_t end = (p + 1) * size / num_parts;
+            memset(data + begin, 0, end - begin);
+        }
+    }
+    return true;
+}
+
+} // bace
+
+#endif // NUMA_TCC_
@@ -12,6 +12,7 @@
 #define PROVER_HPP_
 
 #include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
 #include "src/proof_system/common.hpp"
 
 namespace bace {
@@ -21,14 +22,23 @@ namespace bace {
  * a batch of inputs.
  *
  * The prover constructs a proof by using the input batch to compose a
- * column_lde_t and extend it to a large degree. The prover takes the FFT
- * of the each column_lde_t and evaluates the columns index-wise on the
- * provided circuit, then takes the inverse FFT of this vector construction.
- * This results in a large degree sized vector of circuit evaluations, which
- * serves as the basis for the proof that is provided to the verifier.
+ * column_lde_t and extend it to a large degree. The prover evaluates each
+ * column_lde_t over the large domain and evaluates the columns index-wise
+ * on the provided circuit, then takes the inverse FFT of this vector
+ * construction. This results in a large degree sized vector of circuit
+ * evaluations, which serves as the basis for the proof that is provided to
+ * the verifier.
+ *
+ * The columns are extended one coset of the column domain at a time, by
+ * large_degree / column_size coset FFTs of size column_size, so that only
+ * input_size * column_size extended values are held at once. The large
+ * domain need not be a power of two (see get_large_degree()).
  *
  * proof = circuit.evaluate(column_lde[1][i], ... , column_lde[input_size][i])
  *
+ * The proof is for the circuit's first output (see add_output()); the
+ * outputs of a multi-output circuit are proven by the prover below.
+ *
  * In the case that there is a size mismatch among the batch of inputs,
  * the prover will return a proof composed of a vector of zeros, or error if
  * the input size fails to match the circuit's defined input size.
@@ -38,6 +48,80 @@ void prover(const arithmetic_circuit_t<FieldT> &circuit,
             const input_batch_t<FieldT> &input_batch,
             proof_t<FieldT> &proof);
 
+/*
+ * Returns one proof per output of the given circuits, in the order of the
+ * circuits and of their outputs, for the same batch of inputs.
+ *
+ * The column_lde_t and the coset FFTs that extend it are computed once and
+ * shared by all circuits, which are evaluated on each coset in turn. All
+ * proofs are over the large domain of the largest circuit degree, so the
+ * proofs of circuits of lower degree end with zero coefficients.
+ */
+template<typename FieldT>
+void prover(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+            const input_batch_t<FieldT> &input_batch,
+            std::vector<proof_t<FieldT> > &proofs);
+
+/*
+ * Evaluates the circuit on one coset of the large domain, given the values
+ * of the columns on the coset, and writes the evaluation at point t of the
+ * coset to proof[offset + stride * t].
+ */
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &coset_lde,
+                    const size_t &offset,
+                    const size_t &stride,
+                    proof_t<FieldT> &proof);
+
+/*
+ * Same as above, for the first proofs.size() outputs of the circuit: the
+ * evaluation of output k is written to proofs[k][offset + stride * t].
+ */
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &coset_lde,
+                    const size_t &offset,
+                    const size_t &stride,
+                    const std::vector<FieldT*> &proofs);
+
+/*
+ * The per-thread buffers of evaluate_coset(): a batch scratch and an output
+ * block for each of num_threads threads, allocated once so that they can be
+ * reused across cosets and proofs.
+ */
+template<typename FieldT>
+struct evaluation_workspace_t
+{
+    evaluation_workspace_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                           const size_t &block_size,
+                           const size_t &num_threads);
+
+    /* For cosets of coset_size points, in default blocks, on every thread of the OpenMP pool */
+    evaluation_workspace_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                           const size_t &coset_size);
+
+    size_t block_size;
+    std::vector<std::vector<FieldT> > scratch;
+    std::vector<std::vector<FieldT> > output;
+};
+
+/*
+ * Same as above, given the values of the input_size columns on the coset
+ * as one column-major buffer of coset_size values per column, and using the
+ * buffers of a workspace for the compiled circuit. At most
+ * workspace.scratch.size() threads are used.
+ */
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const FieldT *coset_values,
+                    const size_t &input_size,
+                    const size_t &coset_size,
+                    const size_t &offset,
+                    const size_t &stride,
+                    const std::vector<FieldT*> &proofs,
+                    evaluation_workspace_t<FieldT> &workspace);
+
 } // bace
 
 #include "prover.tcc"
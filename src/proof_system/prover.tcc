@@ -13,8 +13,120 @@
 #ifndef PROVER_TCC_
 #define PROVER_TCC_
 
+#include <algorithm>
+#include <cassert>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
 namespace bace {
 
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &coset_lde,
+                    const size_t &offset,
+                    const size_t &stride,
+                    proof_t<FieldT> &proof)
+{
+    evaluate_coset(compiled_circuit, coset_lde, offset, stride, std::vector<FieldT*> { proof.data() });
+}
+
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &coset_lde,
+                    const size_t &offset,
+                    const size_t &stride,
+                    const std::vector<FieldT*> &proofs)
+{
+    evaluation_workspace_t<FieldT> workspace(compiled_circuit, coset_lde.column_size());
+    evaluate_coset(compiled_circuit, coset_lde.data(), coset_lde.num_columns(), coset_lde.column_size(), offset, stride, proofs, workspace);
+}
+
+template<typename FieldT>
+evaluation_workspace_t<FieldT>::evaluation_workspace_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                                                       const size_t &block_size,
+                                                       const size_t &num_threads) :
+    block_size(block_size),
+    scratch(num_threads, compiled_circuit.get_batch_scratch(block_size)),
+    output(num_threads, std::vector<FieldT>(std::max<size_t>(compiled_circuit.num_outputs(), 1) * block_size))
+{
+}
+
+template<typename FieldT>
+evaluation_workspace_t<FieldT>::evaluation_workspace_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                                                       const size_t &coset_size) :
+#ifdef MULTICORE
+    evaluation_workspace_t(compiled_circuit, std::min(coset_size, DEFAULT_BLOCK_SIZE), omp_get_max_threads())
+#else
+    evaluation_workspace_t(compiled_circuit, std::min(coset_size, DEFAULT_BLOCK_SIZE), 1)
+#endif
+{
+}
+
+template<typename FieldT>
+void evaluate_coset(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const FieldT *coset_values,
+                    const size_t &input_size,
+                    const size_t &coset_size,
+                    const size_t &offset,
+                    const size_t &stride,
+                    const std::vector<FieldT*> &proofs,
+                    evaluation_workspace_t<FieldT> &workspace)
+{
+    const size_t block_size = std::min(coset_size, workspace.block_size);
+    const size_t num_blocks = (coset_size + block_size - 1) / block_size;
+    const size_t num_outputs = proofs.size();
+    assert(num_outputs <= std::max<size_t>(compiled_circuit.num_outputs(), 1));
+
+    /*
+     * Evaluation is split into blocks of points, handed out to threads a
+     * block at a time. Each thread owns its scratch, and blocks write to
+     * disjoint points of the proof, so no other state is shared.
+     */
+#ifdef MULTICORE
+    #pragma omp parallel num_threads(workspace.scratch.size())
+#endif
+    {
+#ifdef MULTICORE
+        const size_t thread = omp_get_thread_num();
+#else
+        const size_t thread = 0;
+#endif
+        std::vector<FieldT> &scratch = workspace.scratch[thread];
+        std::vector<FieldT> &output = workspace.output[thread];
+        const size_t row_size = workspace.block_size; // Row stride of the scratch
+#ifdef MULTICORE
+        #pragma omp for schedule(dynamic)
+#endif
+        for (size_t b = 0; b < num_blocks; b++)
+        {
+            const size_t t = b * block_size;
+            const size_t num_points = std::min(block_size, coset_size - t);
+            for (size_t j = 0; j < input_size; j++) // Input j is row j of scratch
+            {
+                const FieldT *column = coset_values + j * coset_size;
+                std::copy(column + t, column + t + num_points, scratch.begin() + j * row_size);
+            }
+
+            if (num_outputs == 1)
+            {
+                compiled_circuit.evaluate_batch(scratch, row_size, num_points, output.data());
+            }
+            else
+            {
+                compiled_circuit.evaluate_batch_outputs(scratch, row_size, num_points, output.data());
+            }
+            for (size_t k = 0; k < num_outputs; k++)
+            {
+                for (size_t p = 0; p < num_points; p++)
+                {
+                    proofs[k][offset + stride * (t + p)] = output[k * row_size + p];
+                }
+            }
+        }
+    }
+}
+
 template<typename FieldT>
 void prover(const arithmetic_circuit_t<FieldT> &circuit,
             const input_batch_t<FieldT> &input_batch,
@@ -23,29 +135,118 @@ void prover(const arithmetic_circuit_t<FieldT> &circuit,
     const size_t batch_size = input_batch.size();
     const size_t input_size = get_input_size(input_batch);
     const size_t column_size = get_column_size(batch_size);
-    const size_t large_degree = get_large_degree(column_size, circuit.degree());
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+    const size_t num_cosets = large_degree / column_size;
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+    const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
+
+    INSTRUMENT_START(lde_start);
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    INSTRUMENT_STOP(lde_start, PHASE_COLUMN_LDE);
+
+    /*
+     * The large domain is the disjoint union of num_cosets cosets of the
+     * column domain H (see fft_domain_t). Each coset is evaluated by a
+     * column_size coset FFT per column, fed through the circuit and
+     * discarded, and only one coset of the column LDE is held at a time.
+     * The evaluation buffers are allocated once, for all cosets.
+     */
+    proof.resize(large_degree);
+    INSTRUMENT_COUNT(COUNTER_BYTES_ALLOCATED, large_degree * sizeof(FieldT));
+    const std::vector<FieldT*> proofs { proof.data() };
+    evaluation_workspace_t<FieldT> workspace(compiled_circuit, column_size);
+    column_lde_t<FieldT> coset_lde;
+    const size_t stride = domain->coset_stride(column_size);
+    for (size_t c = 0; c < num_cosets; c++)
+    {
+        INSTRUMENT_START(fft_start);
+        coset_lde = column_lde;
+        column_domain->batch_cosetFFT(coset_lde.data(), input_size, domain->coset_shift(c, column_size));
+        INSTRUMENT_STOP(fft_start, PHASE_COSET_FFT);
+
+        INSTRUMENT_START(evaluation_start);
+        evaluate_coset(compiled_circuit, coset_lde.data(), input_size, column_size,
+                       domain->coset_offset(c, column_size), stride, proofs, workspace);
+        INSTRUMENT_STOP(evaluation_start, PHASE_COSET_EVALUATION);
+    }
+
+    INSTRUMENT_START(ifft_start);
+    domain->iFFT(proof);
+    INSTRUMENT_STOP(ifft_start, PHASE_PROOF_IFFT);
+}
+
+template<typename FieldT>
+void prover(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+            const input_batch_t<FieldT> &input_batch,
+            std::vector<proof_t<FieldT> > &proofs)
+{
+    const size_t batch_size = input_batch.size();
+    const size_t input_size = get_input_size(input_batch);
+    const size_t column_size = get_column_size(batch_size);
+
+    std::vector<compiled_circuit_t<FieldT> > compiled_circuits;
+    size_t degree = 0;
+    size_t num_outputs = 0;
+    for (const arithmetic_circuit_t<FieldT> &circuit : circuits)
+    {
+        compiled_circuits.emplace_back(circuit);
+        degree = std::max(degree, compiled_circuits.back().degree());
+        num_outputs += compiled_circuits.back().num_outputs();
+    }
+
+    const size_t large_degree = get_large_degree(column_size, degree);
+    const size_t num_cosets = large_degree / column_size;
     const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+    const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
 
-    column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    INSTRUMENT_START(lde_start);
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    INSTRUMENT_STOP(lde_start, PHASE_COLUMN_LDE);
 
-    for (size_t i = 0; i < input_size; i++)
+    /* The proofs of each circuit's outputs, in order */
+    proofs.assign(num_outputs, proof_t<FieldT>(large_degree, FieldT::zero()));
+    INSTRUMENT_COUNT(COUNTER_BYTES_ALLOCATED, num_outputs * large_degree * sizeof(FieldT));
+    std::vector<std::vector<FieldT*> > circuit_proofs(circuits.size());
+    for (size_t i = 0, k = 0; i < circuits.size(); i++)
     {
-        column_lde[i].resize(large_degree, FieldT::zero());
-        domain->FFT(column_lde[i]);
+        for (size_t j = 0; j < compiled_circuits[i].num_outputs(); j++)
+        {
+            circuit_proofs[i].emplace_back(proofs[k++].data());
+        }
     }
 
-    proof.resize(large_degree);
-    std::vector<FieldT> input_column(input_size);
-    for (size_t i = 0; i < large_degree; i++)
+    /* Each coset is extended once, then evaluated on every circuit (see above) */
+    std::vector<evaluation_workspace_t<FieldT> > workspaces;
+    for (const compiled_circuit_t<FieldT> &compiled_circuit : compiled_circuits)
     {
-        for (size_t j = 0; j < input_size; j++)
+        workspaces.emplace_back(compiled_circuit, column_size);
+    }
+    column_lde_t<FieldT> coset_lde;
+    const size_t stride = domain->coset_stride(column_size);
+    for (size_t c = 0; c < num_cosets; c++)
+    {
+        INSTRUMENT_START(fft_start);
+        coset_lde = column_lde;
+        column_domain->batch_cosetFFT(coset_lde.data(), input_size, domain->coset_shift(c, column_size));
+        INSTRUMENT_STOP(fft_start, PHASE_COSET_FFT);
+
+        INSTRUMENT_START(evaluation_start);
+        for (size_t i = 0; i < circuits.size(); i++)
         {
-            input_column[j] = column_lde[j][i];
+            if (circuit_proofs[i].empty()) continue;
+            evaluate_coset(compiled_circuits[i], coset_lde.data(), input_size, column_size,
+                           domain->coset_offset(c, column_size), stride, circuit_proofs[i], workspaces[i]);
         }
-        
-        proof[i] = circuit.evaluate(input_column);
+        INSTRUMENT_STOP(evaluation_start, PHASE_COSET_EVALUATION);
     }
-    domain->iFFT(proof);
+
+    INSTRUMENT_START(ifft_start);
+    for (proof_t<FieldT> &proof : proofs)
+    {
+        domain->iFFT(proof);
+    }
+    INSTRUMENT_STOP(ifft_start, PHASE_PROOF_IFFT);
 }
 
 } // bace
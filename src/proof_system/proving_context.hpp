@@ -0,0 +1,126 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the proving context.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PROVING_CONTEXT_HPP_
+#define PROVING_CONTEXT_HPP_
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
+#include "src/common/mapped_file.hpp"
+#include "src/proof_system/common.hpp"
+#include "src/proof_system/numa.hpp"
+#include "src/proof_system/prover.hpp"
+
+namespace bace {
+
+/*
+ * A proving context proves many input batches of the same shape for one
+ * circuit, as prover() does, without allocating from the heap once the
+ * first proof of a given batch size is done.
+ *
+ * The circuit is compiled once, and all buffers of a proof live in one
+ * arena_t, laid out as
+ *
+ * [ column LDE (input_size * column_size) | coset values (input_size * column_size) | proof (large_degree) ]
+ *
+ * so the FFTs and the circuit evaluation stream through contiguous memory.
+ * The per-thread scratch of the evaluation is held in an
+ * evaluation_workspace_t. The buffers only depend on the column size, so
+ * batches of any size up to it share them; proving a batch of another
+ * column size reshapes the context, which reallocates the arena.
+ *
+ * The proof is left in the arena, where proof() returns it until the next
+ * call to prove(); it can be passed as is to the verifier, which accepts a
+ * pointer and a size in place of a proof_t.
+ *
+ * On a NUMA machine, the placement decides where the arena's pages go (see
+ * memory_placement_t). Under PLACEMENT_LOCAL and PLACEMENT_INTERLEAVED, the
+ * OpenMP threads are pinned node by node when the arena is allocated, and
+ * their previous affinity is restored when the context is destroyed. Under
+ * PLACEMENT_LOCAL, the column LDE and the coset values are first touched
+ * column by column, as the batched FFTs split them across threads. The
+ * proof, which every thread writes at strided points of each coset, has no
+ * part local to a thread, so its pages are left to the first thread that
+ * writes them, as under PLACEMENT_NAIVE. is_placed() tells whether the
+ * placement could be applied.
+ */
+template<typename FieldT>
+class proving_context_t {
+    /* The buffers are raw arena memory, used without constructing elements */
+    static_assert(std::is_trivially_copyable<FieldT>::value,
+                  "proving_context_t expects a trivially copyable field type");
+public:
+    proving_context_t(const arithmetic_circuit_t<FieldT> &circuit,
+                      const bool &huge_pages = false,
+                      const memory_placement_t &placement = PLACEMENT_NAIVE);
+
+    /* Same as above, for a circuit already compiled (ex. loaded from a circuit file) */
+    proving_context_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                      const bool &huge_pages = false,
+                      const memory_placement_t &placement = PLACEMENT_NAIVE);
+
+    ~proving_context_t();
+
+    /* Proves input_batch, whose inputs must match the circuit's input size */
+    void prove(const input_batch_t<FieldT> &input_batch);
+
+    /* Proves input_batch, and copies the proof into proof */
+    void prove(const input_batch_t<FieldT> &input_batch, proof_t<FieldT> &proof);
+
+    /* Returns the proof of the last call to prove() */
+    const FieldT *proof() const;
+    size_t proof_size() const;
+
+    /* Returns the batch size of the current shape, or 0 before the first proof */
+    size_t batch_size() const;
+
+    /* Returns the number of bytes of the arena */
+    size_t arena_size() const;
+
+    /*
+     * Returns whether the threads were pinned and the arena placed as the
+     * placement asks. The kernel may refuse (ex. without NUMA support), in
+     * which case the pages are placed as under PLACEMENT_NAIVE.
+     */
+    bool is_placed() const;
+
+private:
+    compiled_circuit_t<FieldT> _compiled_circuit;
+    bool _huge_pages;
+    memory_placement_t _placement;
+    bool _placed;
+    std::vector<cpu_set_t> _previous_affinity;
+
+    size_t _batch_size;
+    size_t _column_size;
+    size_t _large_degree;
+    domain_t<FieldT> _domain;
+    domain_t<FieldT> _column_domain;
+
+    std::unique_ptr<arena_t> _arena;
+    FieldT *_column_lde;
+    FieldT *_coset_values;
+    FieldT *_proof;
+    std::vector<FieldT> _shift_powers;
+    std::vector<FieldT*> _proofs;
+    std::unique_ptr<evaluation_workspace_t<FieldT> > _workspace;
+
+    void reshape(const size_t &batch_size);
+};
+
+} // bace
+
+#include "proving_context.tcc"
+
+#endif // PROVING_CONTEXT_HPP_
@@ -0,0 +1,185 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the proving context.
+
+ See proving_context.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PROVING_CONTEXT_TCC_
+#define PROVING_CONTEXT_TCC_
+
+#include <algorithm>
+#include <cassert>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace bace {
+
+template<typename FieldT>
+proving_context_t<FieldT>::proving_context_t(const arithmetic_circuit_t<FieldT> &circuit,
+                                             const bool &huge_pages,
+                                             const memory_placement_t &placement) :
+    _compiled_circuit(circuit), _huge_pages(huge_pages), _placement(placement), _placed(true),
+    _batch_size(0), _column_size(0), _large_degree(0),
+    _column_lde(nullptr), _coset_values(nullptr), _proof(nullptr)
+{
+}
+
+template<typename FieldT>
+proving_context_t<FieldT>::proving_context_t(const compiled_circuit_t<FieldT> &compiled_circuit,
+                                             const bool &huge_pages,
+                                             const memory_placement_t &placement) :
+    _compiled_circuit(compiled_circuit), _huge_pages(huge_pages), _placement(placement), _placed(true),
+    _batch_size(0), _column_size(0), _large_degree(0),
+    _column_lde(nullptr), _coset_values(nullptr), _proof(nullptr)
+{
+}
+
+template<typename FieldT>
+proving_context_t<FieldT>::~proving_context_t()
+{
+    if (!this->_previous_affinity.empty()) set_thread_affinity(this->_previous_affinity);
+}
+
+template<typename FieldT>
+void proving_context_t<FieldT>::reshape(const size_t &batch_size)
+{
+    const size_t input_size = this->_compiled_circuit.num_inputs();
+    this->_batch_size = batch_size;
+    this->_column_size = get_column_size(batch_size);
+    this->_large_degree = get_large_degree(this->_column_size, this->_compiled_circuit.degree());
+    this->_domain = get_evaluation_domain<FieldT>(this->_large_degree);
+    this->_column_domain = get_evaluation_domain<FieldT>(this->_column_size);
+
+    /* Each buffer starts on a cache line */
+    const size_t line = CACHE_LINE_SIZE / std::min(CACHE_LINE_SIZE, sizeof(FieldT));
+    const size_t column_lde_size = (input_size * this->_column_size + line - 1) / line * line;
+    this->_arena.reset();
+    this->_arena.reset(new arena_t((2 * column_lde_size + this->_large_degree) * sizeof(FieldT), this->_huge_pages));
+    INSTRUMENT_COUNT(COUNTER_BYTES_ALLOCATED, this->_arena->size());
+
+    this->_column_lde = reinterpret_cast<FieldT*>(this->_arena->data());
+    this->_coset_values = this->_column_lde + column_lde_size;
+    this->_proof = this->_coset_values + column_lde_size;
+    this->_proofs.assign(1, this->_proof);
+    this->_shift_powers.resize(this->_column_size);
+
+#ifdef MULTICORE
+    const size_t num_threads = omp_get_max_threads();
+#else
+    const size_t num_threads = 1;
+#endif
+
+    /* The arena is not written yet, so its pages are placed on first touch */
+    if (this->_placement != PLACEMENT_NAIVE)
+    {
+        if (this->_previous_affinity.empty()) this->_previous_affinity = get_thread_affinity();
+        this->_placed = pin_threads(this->_placement);
+    }
+    if (this->_placement == PLACEMENT_INTERLEAVED)
+    {
+        this->_placed = place_memory(this->_arena->data(), this->_arena->size(), 1, PLACEMENT_INTERLEAVED) && this->_placed;
+    }
+    else if (this->_placement == PLACEMENT_LOCAL)
+    {
+        const size_t column_lde_bytes = column_lde_size * sizeof(FieldT);
+        place_memory(this->_arena->data(), column_lde_bytes, input_size, PLACEMENT_LOCAL);
+        place_memory(this->_arena->data() + column_lde_bytes, column_lde_bytes, input_size, PLACEMENT_LOCAL);
+    }
+    const size_t block_size = std::min(this->_column_size, DEFAULT_BLOCK_SIZE);
+    this->_workspace.reset(new evaluation_workspace_t<FieldT>(this->_compiled_circuit, block_size, num_threads));
+}
+
+template<typename FieldT>
+void proving_context_t<FieldT>::prove(const input_batch_t<FieldT> &input_batch)
+{
+    const size_t input_size = this->_compiled_circuit.num_inputs();
+    assert(get_input_size(input_batch) == input_size);
+    if (get_column_size(input_batch.size()) != this->_column_size) this->reshape(input_batch.size());
+    this->_batch_size = input_batch.size();
+
+    const size_t column_size = this->_column_size;
+    const size_t num_cosets = this->_large_degree / column_size;
+
+    INSTRUMENT_START(lde_start);
+    compute_column_lde(input_batch, column_size, this->_column_lde);
+    INSTRUMENT_STOP(lde_start, PHASE_COLUMN_LDE);
+
+    /* As in prover(), one coset at a time, the shift being applied while copying */
+    const size_t stride = this->_domain->coset_stride(column_size);
+    for (size_t c = 0; c < num_cosets; c++)
+    {
+        INSTRUMENT_START(fft_start);
+        const FieldT shift = this->_domain->coset_shift(c, column_size);
+        this->_shift_powers[0] = FieldT::one();
+        for (size_t j = 1; j < column_size; j++) this->_shift_powers[j] = this->_shift_powers[j - 1] * shift;
+#ifdef MULTICORE
+        #pragma omp parallel for
+#endif
+        for (size_t i = 0; i < input_size; i++)
+        {
+            const FieldT *column = this->_column_lde + i * column_size;
+            FieldT *values = this->_coset_values + i * column_size;
+            for (size_t j = 0; j < column_size; j++) values[j] = column[j] * this->_shift_powers[j];
+        }
+        INSTRUMENT_COUNT(COUNTER_FIELD_MULTIPLICATIONS, (input_size + 1) * column_size);
+        this->_column_domain->batch_FFT(this->_coset_values, input_size);
+        INSTRUMENT_STOP(fft_start, PHASE_COSET_FFT);
+
+        INSTRUMENT_START(evaluation_start);
+        evaluate_coset(this->_compiled_circuit, this->_coset_values, input_size, column_size,
+                       this->_domain->coset_offset(c, column_size), stride, this->_proofs, *this->_workspace);
+        INSTRUMENT_STOP(evaluation_start, PHASE_COSET_EVALUATION);
+    }
+
+    INSTRUMENT_START(ifft_start);
+    this->_domain->batch_iFFT(this->_proof, 1);
+    INSTRUMENT_STOP(ifft_start, PHASE_PROOF_IFFT);
+}
+
+template<typename FieldT>
+void proving_context_t<FieldT>::prove(const input_batch_t<FieldT> &input_batch, proof_t<FieldT> &proof)
+{
+    this->prove(input_batch);
+    proof.assign(this->_proof, this->_proof + this->_large_degree);
+}
+
+template<typename FieldT>
+const FieldT *proving_context_t<FieldT>::proof() const
+{
+    return this->_proof;
+}
+
+template<typename FieldT>
+size_t proving_context_t<FieldT>::proof_size() const
+{
+    return this->_large_degree;
+}
+
+template<typename FieldT>
+size_t proving_context_t<FieldT>::batch_size() const
+{
+    return this->_batch_size;
+}
+
+template<typename FieldT>
+size_t proving_context_t<FieldT>::arena_size() const
+{
+    return this->_arena ? this->_arena->size() : 0;
+}
+
+template<typename FieldT>
+bool proving_context_t<FieldT>::is_placed() const
+{
+    return this->_placed;
+}
+
+} // bace
+
+#endif // PROVING_CONTEXT_TCC_
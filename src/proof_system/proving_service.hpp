@@ -0,0 +1,156 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the asynchronous proving service.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PROVING_SERVICE_HPP_
+#define PROVING_SERVICE_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/proof_system/common.hpp"
+#include "src/proof_system/proving_context.hpp"
+
+namespace bace {
+
+/* A proof, along with the batch it proves */
+template<typename FieldT>
+struct batch_proof_t
+{
+    input_batch_t<FieldT> input_batch;
+    proof_t<FieldT> proof;
+};
+
+/*
+ * The result of a request to the proving service: the inputs of the
+ * request, and their outputs.
+ *
+ * Requests may be coalesced with others into one batch, proved once, so a
+ * proof is that of the coalesced batch. When the result can hold it (see
+ * proving_service_t), proof is that batch and its proof, of which the
+ * inputs of the request are the rows offset, ... , offset +
+ * input_batch.size() - 1; otherwise proof is null.
+ */
+template<typename FieldT>
+struct proving_result_t
+{
+    input_batch_t<FieldT> input_batch;
+    output_batch_t<FieldT> output_batch;
+    std::shared_ptr<const batch_proof_t<FieldT> > proof;
+    size_t offset;
+};
+
+struct proving_service_stats_t
+{
+    size_t num_requests; // Requests proved
+    size_t num_proofs;   // Proofs computed for them
+};
+
+/*
+ * An asynchronous front-end to the prover, for many small batches.
+ *
+ * submit() queues a request, and returns a future of its result. A pool of
+ * num_workers threads serves the queue: a worker takes the oldest request,
+ * along with every other queued request for the same circuit (the same
+ * circuit object) as long as the batch sizes add up to at most
+ * max_batch_size, and proves the concatenation of their batches at once. As
+ * the fixed cost of a proof (compiling the circuit, setting up domains and
+ * buffers) dominates small batches, this raises the throughput under many
+ * small requests. Each worker keeps a proving_context_t per circuit, so
+ * successive proofs reuse its buffers.
+ *
+ * A proof of a coalesced batch cannot be split per request: verifying it
+ * takes the inputs of all coalesced requests, and it reveals all their
+ * outputs. So a result only holds the proof when its request was proved
+ * alone, or when share_proofs is set, for callers whose requests may see
+ * each other's inputs and outputs (ex. the requests of a single client).
+ * Otherwise, the outputs of a coalesced request come unverified; a caller
+ * that needs to verify every request without sharing sets max_batch_size
+ * to 0, so that no request is coalesced, at the cost of one proof each.
+ *
+ * The queue holds at most queue_capacity requests: beyond it, submit()
+ * blocks until a worker frees a place (backpressure), and try_submit()
+ * returns false. Requests still queued when the service is destroyed are
+ * proved before the workers stop.
+ *
+ * pause() keeps the workers from taking requests until resume(), while
+ * submit() still queues them (ex. to fill the queue before the workers
+ * coalesce it). A paused service still proves its queued requests when
+ * destroyed.
+ *
+ * A request whose inputs do not match the circuit's input size gets a
+ * std::invalid_argument through its future.
+ */
+template<typename FieldT>
+class proving_service_t {
+public:
+    proving_service_t(const size_t &num_workers,
+                      const size_t &queue_capacity,
+                      const size_t &max_batch_size,
+                      const bool &share_proofs = false);
+    ~proving_service_t();
+
+    proving_service_t(const proving_service_t &) = delete;
+    proving_service_t &operator=(const proving_service_t &) = delete;
+
+    std::future<proving_result_t<FieldT> > submit(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                                                  input_batch_t<FieldT> input_batch);
+
+    /* As submit(), but returns false at once when the queue is full */
+    bool try_submit(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                    input_batch_t<FieldT> input_batch,
+                    std::future<proving_result_t<FieldT> > &result);
+
+    /* Stops the workers from taking further requests, until resume() */
+    void pause();
+    void resume();
+
+    proving_service_stats_t stats() const;
+
+private:
+    struct request_t
+    {
+        std::shared_ptr<const arithmetic_circuit_t<FieldT> > circuit;
+        input_batch_t<FieldT> input_batch;
+        std::promise<proving_result_t<FieldT> > promise;
+    };
+
+    size_t _queue_capacity;
+    size_t _max_batch_size;
+    bool _share_proofs;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+    std::deque<request_t> _queue;
+    bool _paused;
+    bool _stopping;
+    proving_service_stats_t _stats;
+    std::vector<std::thread> _workers;
+
+    std::future<proving_result_t<FieldT> > enqueue(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                                                   input_batch_t<FieldT> &input_batch);
+    void run_worker();
+
+    /* Proves the concatenation of the batches of requests, and fulfills them */
+    void prove_requests(proving_context_t<FieldT> &context,
+                        std::vector<request_t> &requests);
+};
+
+} // bace
+
+#include "proving_service.tcc"
+
+#endif // PROVING_SERVICE_HPP_
@@ -0,0 +1,207 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the asynchronous proving service.
+
+ See proving_service.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PROVING_SERVICE_TCC_
+#define PROVING_SERVICE_TCC_
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace bace {
+
+/* Number of circuits whose proving_context_t a worker keeps */
+const size_t MAX_CACHED_CONTEXTS = 16;
+
+template<typename FieldT>
+proving_service_t<FieldT>::proving_service_t(const size_t &num_workers,
+                                             const size_t &queue_capacity,
+                                             const size_t &max_batch_size,
+                                             const bool &share_proofs) :
+    _queue_capacity(std::max<size_t>(queue_capacity, 1)), _max_batch_size(max_batch_size),
+    _share_proofs(share_proofs), _paused(false), _stopping(false)
+{
+    this->_stats.num_requests = 0;
+    this->_stats.num_proofs = 0;
+    for (size_t i = 0; i < std::max<size_t>(num_workers, 1); i++)
+    {
+        this->_workers.emplace_back(&proving_service_t<FieldT>::run_worker, this);
+    }
+}
+
+template<typename FieldT>
+proving_service_t<FieldT>::~proving_service_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stopping = true;
+    }
+    this->_not_empty.notify_all();
+    for (std::thread &worker : this->_workers) worker.join();
+}
+
+template<typename FieldT>
+std::future<proving_result_t<FieldT> > proving_service_t<FieldT>::submit(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                                                                         input_batch_t<FieldT> input_batch)
+{
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_not_full.wait(lock, [this]() { return this->_queue.size() < this->_queue_capacity; });
+    return this->enqueue(circuit, input_batch);
+}
+
+template<typename FieldT>
+bool proving_service_t<FieldT>::try_submit(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                                           input_batch_t<FieldT> input_batch,
+                                           std::future<proving_result_t<FieldT> > &result)
+{
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    if (this->_queue.size() >= this->_queue_capacity) return false;
+    result = this->enqueue(circuit, input_batch);
+    return true;
+}
+
+/* Called with the mutex held, and a free place in the queue */
+template<typename FieldT>
+std::future<proving_result_t<FieldT> > proving_service_t<FieldT>::enqueue(const std::shared_ptr<const arithmetic_circuit_t<FieldT> > &circuit,
+                                                                          input_batch_t<FieldT> &input_batch)
+{
+    request_t request;
+    request.circuit = circuit;
+    request.input_batch = std::move(input_batch);
+    std::future<proving_result_t<FieldT> > result = request.promise.get_future();
+
+    if (request.input_batch.empty() || get_input_size(request.input_batch) != circuit->num_inputs())
+    {
+        request.promise.set_exception(std::make_exception_ptr(
+            std::invalid_argument("proving_service_t: input size mismatch")));
+        return result;
+    }
+
+    this->_queue.emplace_back(std::move(request));
+    this->_not_empty.notify_one();
+    return result;
+}
+
+template<typename FieldT>
+void proving_service_t<FieldT>::pause()
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_paused = true;
+}
+
+template<typename FieldT>
+void proving_service_t<FieldT>::resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_paused = false;
+    }
+    this->_not_empty.notify_all();
+}
+
+template<typename FieldT>
+proving_service_stats_t proving_service_t<FieldT>::stats() const
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_stats;
+}
+
+template<typename FieldT>
+void proving_service_t<FieldT>::run_worker()
+{
+    std::map<const arithmetic_circuit_t<FieldT>*,
+             std::pair<std::shared_ptr<const arithmetic_circuit_t<FieldT> >,
+                       std::unique_ptr<proving_context_t<FieldT> > > > contexts;
+    while (true)
+    {
+        /* The oldest request, and the queued requests it can be coalesced with */
+        std::vector<request_t> requests;
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_not_empty.wait(lock, [this]() { return this->_stopping || (!this->_paused && !this->_queue.empty()); });
+            if (this->_queue.empty()) return;
+
+            requests.emplace_back(std::move(this->_queue.front()));
+            this->_queue.pop_front();
+            size_t batch_size = requests[0].input_batch.size();
+            for (auto it = this->_queue.begin(); it != this->_queue.end();)
+            {
+                if (it->circuit == requests[0].circuit && batch_size + it->input_batch.size() <= this->_max_batch_size)
+                {
+                    batch_size += it->input_batch.size();
+                    requests.emplace_back(std::move(*it));
+                    it = this->_queue.erase(it);
+                }
+                else
+                {
+                    it++;
+                }
+            }
+            this->_stats.num_requests += requests.size();
+            this->_stats.num_proofs++;
+        }
+        this->_not_full.notify_all();
+
+        const std::shared_ptr<const arithmetic_circuit_t<FieldT> > circuit = requests[0].circuit;
+        try
+        {
+            if (contexts.size() >= MAX_CACHED_CONTEXTS && contexts.count(circuit.get()) == 0) contexts.clear();
+            auto &entry = contexts[circuit.get()];
+            if (!entry.second)
+            {
+                entry.first = circuit; // Keeps the circuit, and so its address, alive
+                entry.second.reset(new proving_context_t<FieldT>(*circuit));
+            }
+            this->prove_requests(*entry.second, requests);
+        }
+        catch (...)
+        {
+            for (request_t &request : requests) request.promise.set_exception(std::current_exception());
+        }
+    }
+}
+
+template<typename FieldT>
+void proving_service_t<FieldT>::prove_requests(proving_context_t<FieldT> &context,
+                                               std::vector<request_t> &requests)
+{
+    std::shared_ptr<batch_proof_t<FieldT> > batch_proof(new batch_proof_t<FieldT>());
+    for (request_t &request : requests)
+    {
+        std::copy(request.input_batch.begin(), request.input_batch.end(), std::back_inserter(batch_proof->input_batch));
+    }
+
+    context.prove(batch_proof->input_batch, batch_proof->proof);
+    output_batch_t<FieldT> output_batch;
+    extract_output_batch(batch_proof->proof, batch_proof->input_batch.size(), output_batch);
+
+    /* Results are only handed out once all of them are ready */
+    const bool share_proof = this->_share_proofs || requests.size() == 1;
+    std::vector<proving_result_t<FieldT> > results(requests.size());
+    for (size_t i = 0, offset = 0; i < requests.size(); i++)
+    {
+        const size_t batch_size = requests[i].input_batch.size();
+        results[i].input_batch = std::move(requests[i].input_batch);
+        results[i].output_batch.assign(output_batch.begin() + offset, output_batch.begin() + offset + batch_size);
+        if (share_proof) results[i].proof = batch_proof;
+        results[i].offset = offset;
+        offset += batch_size;
+    }
+    for (size_t i = 0; i < requests.size(); i++) requests[i].promise.set_value(std::move(results[i]));
+}
+
+} // bace
+
+#endif // PROVING_SERVICE_TCC_
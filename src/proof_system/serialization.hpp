@@ -0,0 +1,70 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for binary serialization of proofs.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef SERIALIZATION_HPP_
+#define SERIALIZATION_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include "src/common/binary_format.hpp"
+#include "src/common/mapped_file.hpp"
+#include "src/proof_system/common.hpp"
+
+namespace bace {
+
+/*
+ * Writes a proof for a batch of batch_size inputs and a circuit of the given
+ * degree to path, keeping only its (column_size - 1) * degree + 1 meaningful
+ * coefficients. Throws std::invalid_argument if a dropped coefficient is not
+ * zero (ex. for a wrong degree), rather than writing another proof.
+ */
+template<typename FieldT>
+void write_proof(const std::string &path,
+                 const proof_t<FieldT> &proof,
+                 const size_t &batch_size,
+                 const size_t &degree);
+
+/*
+ * A proof file mapped in memory, whose coefficients are used in place. The
+ * verifier accepts data() and size() in place of a proof_t.
+ *
+ * The header and the coefficients are checked against the checksum when the
+ * file is opened, which throws std::runtime_error on a mismatch, so a
+ * corrupted proof is never handed to the verifier. This reads the proof
+ * once, which the verifier does anyway.
+ */
+template<typename FieldT>
+class mapped_proof_t {
+public:
+    mapped_proof_t(const std::string &path);
+
+    const FieldT *data() const;
+    size_t size() const;
+
+    size_t batch_size() const;
+    size_t column_size() const;
+    size_t large_degree() const;
+    size_t degree() const;
+
+    /* Returns whether the header and the coefficients match the checksum of the header */
+    bool has_valid_checksum() const;
+
+private:
+    mapped_file_t _file;
+    serialization_header_t _header;
+    const FieldT *_coefficients;
+};
+
+} // bace
+
+#include "serialization.tcc"
+
+#endif // SERIALIZATION_HPP_
@@ -0,0 +1,119 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for binary serialization.
+
+ See serialization.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef SERIALIZATION_TCC_
+#define SERIALIZATION_TCC_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace bace {
+
+static_assert(sizeof(serialization_header_t) % CACHE_LINE_SIZE == 0,
+              "serialization_header_t must keep the elements cache-line aligned");
+
+template<typename FieldT>
+void write_proof(const std::string &path,
+                 const proof_t<FieldT> &proof,
+                 const size_t &batch_size,
+                 const size_t &degree)
+{
+    const size_t column_size = get_column_size(batch_size);
+    serialization_header_t header = get_header<FieldT>(SERIALIZED_PROOF);
+    header.batch_size = batch_size;
+    header.column_size = column_size;
+    header.large_degree = proof.size();
+    header.degree = degree;
+    header.num_elements = std::min(proof.size(), (column_size - 1) * degree + 1);
+    for (size_t i = header.num_elements; i < proof.size(); i++)
+    {
+        if (proof[i] != FieldT::zero())
+        {
+            throw std::invalid_argument("write_proof: nonzero coefficient beyond the degree of the proof");
+        }
+    }
+    header.checksum = get_checksum(reinterpret_cast<const char*>(proof.data()), header.num_elements * sizeof(FieldT),
+                                   get_header_checksum(header));
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) throw std::runtime_error("write_proof: cannot open " + path);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(proof.data(), sizeof(FieldT), header.num_elements, file) == header.num_elements;
+
+    if (fclose(file) != 0 || !ok) throw std::runtime_error("write_proof: cannot write " + path);
+}
+
+template<typename FieldT>
+mapped_proof_t<FieldT>::mapped_proof_t(const std::string &path) :
+    _file(path), _header(read_header<FieldT>(_file, SERIALIZED_PROOF, path))
+{
+    if (this->_header.num_elements > this->_header.large_degree)
+    {
+        throw std::runtime_error("mapped_proof_t: inconsistent header in " + path);
+    }
+    this->_coefficients = reinterpret_cast<const FieldT*>(this->_file.data() + sizeof(serialization_header_t));
+    if (!this->has_valid_checksum())
+    {
+        throw std::runtime_error("mapped_proof_t: checksum mismatch in " + path);
+    }
+}
+
+template<typename FieldT>
+const FieldT *mapped_proof_t<FieldT>::data() const
+{
+    return this->_coefficients;
+}
+
+template<typename FieldT>
+size_t mapped_proof_t<FieldT>::size() const
+{
+    return this->_header.num_elements;
+}
+
+template<typename FieldT>
+size_t mapped_proof_t<FieldT>::batch_size() const
+{
+    return this->_header.batch_size;
+}
+
+template<typename FieldT>
+size_t mapped_proof_t<FieldT>::column_size() const
+{
+    return this->_header.column_size;
+}
+
+template<typename FieldT>
+size_t mapped_proof_t<FieldT>::large_degree() const
+{
+    return this->_header.large_degree;
+}
+
+template<typename FieldT>
+size_t mapped_proof_t<FieldT>::degree() const
+{
+    return this->_header.degree;
+}
+
+template<typename FieldT>
+bool mapped_proof_t<FieldT>::has_valid_checksum() const
+{
+    const char *coefficients = reinterpret_cast<const char*>(this->_coefficients);
+    const uint64_t checksum = get_header_checksum(this->_header);
+    return get_checksum(coefficients, this->_header.num_elements * sizeof(FieldT), checksum) == this->_header.checksum;
+}
+
+} // bace
+
+#endif // SERIALIZATION_TCC_
@@ -0,0 +1,99 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the sharded prover.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef SHARDED_PROVER_HPP_
+#define SHARDED_PROVER_HPP_
+
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
+#include "src/proof_system/common.hpp"
+
+namespace bace {
+
+/*
+ * A shard is a range of cosets of the column domain in the large domain
+ * (see prover()): cosets first_coset, ... , first_coset + num_cosets - 1.
+ * Its evaluations are num_cosets * column_size values, coset-major: the
+ * evaluation at point t of coset first_coset + c is at c * column_size + t.
+ */
+struct shard_t
+{
+    size_t first_coset;
+    size_t num_cosets;
+};
+
+/*
+ * How the coordinator runs the shards:
+ *
+ * - SHARD_IN_PROCESS evaluates the shards one after another in the calling
+ *   process, a local stand-in for remote workers;
+ * - SHARD_PROCESSES forks one worker process per shard, which writes its
+ *   evaluations into memory shared with the coordinator.
+ *
+ * A forked worker only has the calling thread, and inherits every lock in
+ * the state it was in at fork() time. SHARD_PROCESSES must therefore not be
+ * used while other threads may hold a lock the worker takes, such as the
+ * mutex of get_evaluation_domain() (ex. from within a proving_service_t, or
+ * while other threads prove); a worker would deadlock on it.
+ */
+enum shard_transport_t { SHARD_IN_PROCESS, SHARD_PROCESSES };
+
+struct sharding_stats_t
+{
+    size_t num_shards;
+    size_t num_failed; // Shards whose worker failed, evaluated again by the coordinator
+};
+
+/* Splits num_cosets cosets into at most num_shards shards of consecutive cosets */
+std::vector<shard_t> get_shards(const size_t &num_cosets, const size_t &num_shards);
+
+/*
+ * The work of one shard: given the column coefficients of the batch (the
+ * column_lde_t of compute_column_lde()) and the size of the large domain,
+ * writes the evaluations of the circuit on the shard's cosets to
+ * evaluations, in the layout of shard_t. This is everything a worker needs,
+ * so that it can run in another process, or on another host.
+ */
+template<typename FieldT>
+void evaluate_shard(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &column_lde,
+                    const size_t &large_degree,
+                    const shard_t &shard,
+                    FieldT *evaluations);
+
+/*
+ * Returns the same proof as prover(), with the cosets of the large domain
+ * split into num_shards shards, evaluated by workers of the given transport.
+ * The coordinator computes the column_lde_t, gathers the evaluations of the
+ * shards into the proof, and runs the final iFFT.
+ *
+ * A worker that fails (ex. crashes, or is killed) is isolated from the
+ * others: the coordinator evaluates its shard again itself, and counts it in
+ * the returned stats. For testing, the SHARD_PROCESSES worker of shard
+ * failed_shard (an index in get_shards()) exits at once with a failure
+ * status, as if it had crashed.
+ */
+const size_t NO_FAILED_SHARD = static_cast<size_t>(-1);
+
+template<typename FieldT>
+sharding_stats_t sharded_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                const input_batch_t<FieldT> &input_batch,
+                                proof_t<FieldT> &proof,
+                                const size_t &num_shards,
+                                const shard_transport_t &transport = SHARD_PROCESSES,
+                                const size_t &failed_shard = NO_FAILED_SHARD);
+
+} // bace
+
+#include "sharded_prover.tcc"
+
+#endif // SHARDED_PROVER_HPP_
@@ -0,0 +1,176 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the sharded prover.
+
+ See sharded_prover.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef SHARDED_PROVER_TCC_
+#define SHARDED_PROVER_TCC_
+
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+#include "src/common/mapped_file.hpp"
+#include "src/proof_system/prover.hpp"
+
+namespace bace {
+
+inline std::vector<shard_t> get_shards(const size_t &num_cosets, const size_t &num_shards)
+{
+    const size_t count = std::max<size_t>(1, std::min(num_shards, num_cosets));
+    std::vector<shard_t> shards;
+    for (size_t s = 0, first = 0; s < count; s++)
+    {
+        const size_t size = num_cosets / count + (s < num_cosets % count ? 1 : 0);
+        shards.emplace_back(shard_t { first, size });
+        first += size;
+    }
+    return shards;
+}
+
+template<typename FieldT>
+void evaluate_shard(const compiled_circuit_t<FieldT> &compiled_circuit,
+                    const column_lde_t<FieldT> &column_lde,
+                    const size_t &large_degree,
+                    const shard_t &shard,
+                    FieldT *evaluations)
+{
+    const size_t input_size = column_lde.num_columns();
+    const size_t column_size = column_lde.column_size();
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+    const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
+
+    column_lde_t<FieldT> coset_lde;
+    const std::vector<FieldT*> outputs { evaluations };
+    evaluation_workspace_t<FieldT> workspace(compiled_circuit, column_size);
+    for (size_t c = 0; c < shard.num_cosets; c++)
+    {
+        coset_lde = column_lde;
+        column_domain->batch_cosetFFT(coset_lde.data(), input_size, domain->coset_shift(shard.first_coset + c, column_size));
+        evaluate_coset(compiled_circuit, coset_lde.data(), input_size, column_size, c * column_size, 1, outputs, workspace);
+    }
+}
+
+/* Point t of coset c is at coset_offset(c) + coset_stride * t in the large domain */
+template<typename FieldT>
+void gather_shard(const FieldT *evaluations,
+                  const shard_t &shard,
+                  const size_t &column_size,
+                  const domain_t<FieldT> &domain,
+                  proof_t<FieldT> &proof)
+{
+    const size_t stride = domain->coset_stride(column_size);
+    for (size_t c = 0; c < shard.num_cosets; c++)
+    {
+        const FieldT *coset = evaluations + c * column_size;
+        const size_t offset = domain->coset_offset(shard.first_coset + c, column_size);
+        for (size_t t = 0; t < column_size; t++)
+        {
+            proof[offset + stride * t] = coset[t];
+        }
+    }
+}
+
+template<typename FieldT>
+sharding_stats_t sharded_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                const input_batch_t<FieldT> &input_batch,
+                                proof_t<FieldT> &proof,
+                                const size_t &num_shards,
+                                const shard_transport_t &transport,
+                                const size_t &failed_shard)
+{
+    const size_t batch_size = input_batch.size();
+    const size_t column_size = get_column_size(batch_size);
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+    const size_t num_cosets = large_degree / column_size;
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    const std::vector<shard_t> shards = get_shards(num_cosets, num_shards);
+
+    sharding_stats_t stats;
+    stats.num_shards = shards.size();
+    stats.num_failed = 0;
+    proof.resize(large_degree);
+
+    if (transport == SHARD_IN_PROCESS)
+    {
+        std::vector<FieldT> evaluations;
+        for (const shard_t &shard : shards)
+        {
+            evaluations.resize(shard.num_cosets * column_size);
+            evaluate_shard(compiled_circuit, column_lde, large_degree, shard, evaluations.data());
+            gather_shard(evaluations.data(), shard, column_size, domain, proof);
+        }
+    }
+    else
+    {
+        /*
+         * The evaluations of all shards share one mapping, created before the
+         * workers are forked, so each worker writes its own range of it in
+         * place. Workers are single-threaded, as the OpenMP thread pool of the
+         * coordinator does not survive a fork.
+         */
+        arena_t shared(large_degree * sizeof(FieldT), false, true);
+        FieldT *evaluations = reinterpret_cast<FieldT*>(shared.data());
+
+        std::vector<pid_t> workers;
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            const pid_t pid = fork();
+            if (pid == 0)
+            {
+                if (s == failed_shard) _exit(1);
+
+                /* An exception must not unwind into the coordinator's code */
+                try
+                {
+#ifdef MULTICORE
+                    omp_set_num_threads(1);
+#endif
+                    evaluate_shard(compiled_circuit, column_lde, large_degree, shards[s],
+                                   evaluations + shards[s].first_coset * column_size);
+                }
+                catch (...)
+                {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            workers.emplace_back(pid);
+        }
+
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            int status = 0;
+            const bool succeeded = workers[s] > 0 && waitpid(workers[s], &status, 0) == workers[s] &&
+                WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            FieldT *shard_evaluations = evaluations + shards[s].first_coset * column_size;
+            if (!succeeded)
+            {
+                stats.num_failed++;
+                evaluate_shard(compiled_circuit, column_lde, large_degree, shards[s], shard_evaluations);
+            }
+            gather_shard(shard_evaluations, shards[s], column_size, domain, proof);
+        }
+    }
+
+    domain->iFFT(proof);
+    return stats;
+}
+
+} // bace
+
+#endif // SHARDED_PROVER_TCC_
@@ -0,0 +1,71 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the degree-stratified prover.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef STRATIFIED_PROVER_HPP_
+#define STRATIFIED_PROVER_HPP_
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/proof_system/common.hpp"
+
+namespace bace {
+
+struct stratification_stats_t
+{
+    size_t num_strata;       // Distinct domain sizes on which gates are evaluated
+    size_t gate_evaluations; // Sum over the gates of the size of their domain
+    size_t num_extensions;   // Values extended from their domain to a larger one
+};
+
+/*
+ * Returns the same proof as prover(), evaluating each gate on the smallest
+ * domain that determines it, rather than every gate on the large domain.
+ *
+ * On the column_lde_t, a gate of degree d is a polynomial with at most
+ * (column_size - 1) * d + 1 coefficients, so it is determined by its values
+ * on a domain of get_large_degree(column_size, d) points. Gates are evaluated
+ * in order, each on the domain of its degree (see arithmetic_circuit_t's
+ * degrees()); an operand of lower degree, whose domain is smaller, is
+ * extended by an iFFT on its own domain and an FFT on the larger one. Its
+ * coefficients and extensions are kept until its last reader is evaluated.
+ * As for prover(), the proof is that of the circuit's first output, the
+ * coefficients of its values; the overload below proves all outputs.
+ *
+ * A gate of degree d thus costs about column_size * d evaluations instead
+ * of large_degree, at the price of the FFTs of the extensions. This pays
+ * off when most gates are of low degree, with only a few products reaching
+ * the degree of the circuit.
+ *
+ * The price is memory: values are held whole, one per live gate, along with
+ * their coefficients and extensions, so the peak memory grows with the
+ * number of gates live at once, times up to large_degree elements each.
+ * prover() instead holds input_size * column_size extended values and the
+ * proof, whatever the circuit. stratified_prover() is meant for circuits
+ * narrow enough to afford it.
+ */
+template<typename FieldT>
+stratification_stats_t stratified_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                         const input_batch_t<FieldT> &input_batch,
+                                         proof_t<FieldT> &proof);
+
+/*
+ * Same as above, with one proof per output of the circuit, in order, as
+ * prover() returns for { circuit }. The outputs share the evaluation of the
+ * gates, and each one is kept until the end.
+ */
+template<typename FieldT>
+stratification_stats_t stratified_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                         const input_batch_t<FieldT> &input_batch,
+                                         std::vector<proof_t<FieldT> > &proofs);
+
+} // bace
+
+#include "stratified_prover.tcc"
+
+#endif // STRATIFIED_PROVER_HPP_
@@ -0,0 +1,201 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the degree-stratified prover.
+
+ See stratified_prover.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef STRATIFIED_PROVER_TCC_
+#define STRATIFIED_PROVER_TCC_
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace bace {
+
+/* A value of the circuit: its evaluations on its own domain, its coefficients, and its extensions by size */
+template<typename FieldT>
+struct stratified_value_t
+{
+    std::vector<FieldT> evaluations;
+    std::vector<FieldT> coefficients;
+    std::map<size_t, std::vector<FieldT> > extensions;
+};
+
+/* Proves the first proofs.size() outputs of the circuit, as the stratified_prover() overloads do */
+template<typename FieldT>
+stratification_stats_t stratified_prove_outputs(const arithmetic_circuit_t<FieldT> &circuit,
+                                                const input_batch_t<FieldT> &input_batch,
+                                                std::vector<proof_t<FieldT> > &proofs)
+{
+    const size_t batch_size = input_batch.size();
+    const size_t input_size = get_input_size(input_batch);
+    const size_t column_size = get_column_size(batch_size);
+    const size_t large_degree = get_large_degree(column_size, circuit.degree());
+    const std::vector<gate_t<FieldT> > &gates = circuit.gates();
+    assert(input_size == circuit.num_inputs());
+
+    stratification_stats_t stats = { 0, 0, 0 };
+    for (proof_t<FieldT> &proof : proofs) proof.assign(large_degree, FieldT::zero());
+    if (gates.empty()) return stats;
+
+    /* Domain size of each value, and the last gate reading it (if any) */
+    const size_t unread = std::numeric_limits<size_t>::max();
+    const std::vector<size_t> degrees = circuit.degrees();
+    const std::vector<int> outputs = circuit.outputs();
+    assert(proofs.size() <= outputs.size());
+    std::vector<size_t> sizes(circuit.size());
+    std::vector<size_t> last_use(circuit.size(), unread);
+    std::set<size_t> strata;
+    for (size_t v = 0; v < circuit.size(); v++)
+    {
+        sizes[v] = get_large_degree(column_size, degrees[v]);
+    }
+    for (size_t g = 0; g < gates.size(); g++)
+    {
+        for (const input_element_t<FieldT> &input_gate : gates[g].input_gates)
+        {
+            if (input_gate.type == VARIABLE) last_use[input_gate.value.variable - 1] = g;
+        }
+        strata.insert(sizes[input_size + g]);
+    }
+    for (size_t k = 0; k < proofs.size(); k++) last_use[outputs[k] - 1] = gates.size();
+    stats.num_strata = strata.size();
+
+    /* The inputs are known by their coefficients, the column_lde_t */
+    std::vector<stratified_value_t<FieldT> > values(circuit.size());
+    {
+        const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+        for (size_t i = 0; i < input_size; i++)
+        {
+            values[i].coefficients.assign(column_lde[i], column_lde[i] + column_size);
+        }
+    }
+
+    /* Returns the values of v on the domain of the given size, extending them if needed */
+    const auto get_values = [&](const size_t &v, const size_t &size) -> const std::vector<FieldT>&
+    {
+        stratified_value_t<FieldT> &value = values[v];
+        if (size == sizes[v] && !value.evaluations.empty()) return value.evaluations;
+
+        const auto it = value.extensions.find(size);
+        if (it != value.extensions.end()) return it->second;
+
+        if (value.coefficients.empty())
+        {
+            value.coefficients = std::move(value.evaluations);
+            get_evaluation_domain<FieldT>(sizes[v])->iFFT(value.coefficients);
+        }
+        std::vector<FieldT> extension(size, FieldT::zero());
+        std::copy(value.coefficients.begin(), value.coefficients.end(), extension.begin());
+        get_evaluation_domain<FieldT>(size)->FFT(extension);
+        stats.num_extensions++;
+        return value.extensions[size] = std::move(extension);
+    };
+
+    for (size_t g = 0; g < gates.size(); g++)
+    {
+        const gate_t<FieldT> &gate = gates[g];
+        const size_t size = sizes[input_size + g];
+        stats.gate_evaluations += size;
+
+        /* Constant operands are folded into one, applied once to the result */
+        FieldT constant = (gate.type == SUM) ? FieldT::zero() : FieldT::one();
+        std::vector<FieldT> result;
+        for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            if (input_gate.type == CONSTANT)
+            {
+                if (gate.type == SUM) constant += input_gate.value.constant;
+                else constant *= input_gate.value.constant;
+                continue;
+            }
+
+            const std::vector<FieldT> &operand = get_values(input_gate.value.variable - 1, size);
+            if (result.empty())
+            {
+                result = operand;
+                continue;
+            }
+#ifdef MULTICORE
+            #pragma omp parallel for if (size >= (1u << 14))
+#endif
+            for (size_t t = 0; t < size; t++)
+            {
+                if (gate.type == SUM) result[t] += operand[t];
+                else result[t] *= operand[t];
+            }
+        }
+
+        if (result.empty())
+        {
+            result.assign(size, constant);
+        }
+        else if (constant != ((gate.type == SUM) ? FieldT::zero() : FieldT::one()))
+        {
+            for (FieldT &x : result)
+            {
+                if (gate.type == SUM) x += constant;
+                else x *= constant;
+            }
+        }
+        if (last_use[input_size + g] != unread) values[input_size + g].evaluations = std::move(result);
+
+        /* Drops the operands that no later gate reads */
+        for (const input_element_t<FieldT> &input_gate : gate.input_gates)
+        {
+            if (input_gate.type == VARIABLE && last_use[input_gate.value.variable - 1] == g)
+            {
+                values[input_gate.value.variable - 1] = stratified_value_t<FieldT>();
+            }
+        }
+    }
+
+    INSTRUMENT_COUNT(COUNTER_GATES_EVALUATED, stats.gate_evaluations);
+
+    /* Each proof is its output's coefficients, padded to the large domain */
+    for (size_t k = 0; k < proofs.size(); k++)
+    {
+        const size_t output = outputs[k] - 1;
+        stratified_value_t<FieldT> &value = values[output];
+        if (value.coefficients.empty())
+        {
+            value.coefficients = std::move(value.evaluations);
+            get_evaluation_domain<FieldT>(sizes[output])->iFFT(value.coefficients);
+        }
+        std::copy(value.coefficients.begin(), value.coefficients.end(), proofs[k].begin());
+    }
+    return stats;
+}
+
+template<typename FieldT>
+stratification_stats_t stratified_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                         const input_batch_t<FieldT> &input_batch,
+                                         proof_t<FieldT> &proof)
+{
+    std::vector<proof_t<FieldT> > proofs(1);
+    const stratification_stats_t stats = stratified_prove_outputs(circuit, input_batch, proofs);
+    proof = std::move(proofs[0]);
+    return stats;
+}
+
+template<typename FieldT>
+stratification_stats_t stratified_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                                         const input_batch_t<FieldT> &input_batch,
+                                         std::vector<proof_t<FieldT> > &proofs)
+{
+    proofs.resize(circuit.num_outputs());
+    return stratified_prove_outputs(circuit, input_batch, proofs);
+}
+
+} // bace
+
+#endif // STRATIFIED_PROVER_TCC_
@@ -0,0 +1,82 @@
+/** @file
+ *****************************************************************************
+ Declaration of interfaces for the streaming prover and verifier.
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef STREAMING_HPP_
+#define STREAMING_HPP_
+
+#include <string>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/proof_system/common.hpp"
+#include "src/proof_system/mapped_input.hpp"
+
+namespace bace {
+
+/* Default bound on the resident memory of the streaming prover (1 GiB) */
+const size_t DEFAULT_MEMORY_BUDGET = size_t(1) << 30;
+
+/* Default directory of the streaming prover's scratch file */
+const char DEFAULT_SCRATCH_DIRECTORY[] = "/var/tmp";
+
+/*
+ * Returns the same proof as prover(), for an input batch read from a
+ * memory-mapped file instead of held in memory.
+ *
+ * The input columns are streamed through the column iFFTs a group at a time,
+ * reading ahead the next group, and the coefficients are spilled to a mapped
+ * scratch file in scratch_directory. The large domain is then covered by
+ * cosets of a domain of size coset_size <= column_size, the largest for which
+ * one coset of all columns fits in half of the budget left by the proof.
+ * Each column is folded
+ * onto the coset (column(g * x) modulo x^coset_size - 1, streamed from the
+ * scratch file), the columns are transformed by a batched coset_size FFT,
+ * and the coset is evaluated and discarded.
+ *
+ * Besides the circuit's scratch, resident memory, proof included, is thus
+ * bounded by memory_budget, instead of growing with batch_size * input_size.
+ * Folding costs O(column_size) per column and coset, so a smaller budget
+ * trades memory for additional passes over the coefficients. A budget that
+ * cannot hold the proof, one column, and the values of all columns on a
+ * coset of 2 points, twice over, throws std::invalid_argument.
+ */
+template<typename FieldT>
+void streaming_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                      const mapped_input_batch_t<FieldT> &input_batch,
+                      proof_t<FieldT> &proof,
+                      const size_t &memory_budget = DEFAULT_MEMORY_BUDGET,
+                      const std::string &scratch_directory = DEFAULT_SCRATCH_DIRECTORY);
+
+/*
+ * Performs the same check as verifier(), for an input batch read from a
+ * memory-mapped file. The random inputs are computed column by column, with
+ * read-ahead, as each column is a contiguous range of the file; each column
+ * is read once for all num_repetitions random elements.
+ */
+template<typename FieldT>
+void streaming_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                        const mapped_input_batch_t<FieldT> &input_batch,
+                        output_batch_t<FieldT> &output_batch,
+                        const proof_t<FieldT> &proof,
+                        const size_t &num_repetitions = 1);
+
+/* Same as above, for a proof held outside of a proof_t (see verifier()) */
+template<typename FieldT>
+void streaming_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                        const mapped_input_batch_t<FieldT> &input_batch,
+                        output_batch_t<FieldT> &output_batch,
+                        const FieldT *proof,
+                        const size_t &proof_size,
+                        const size_t &num_repetitions = 1);
+
+} // bace
+
+#include "streaming.tcc"
+
+#endif // STREAMING_HPP_
@@ -0,0 +1,206 @@
+/** @file
+ *****************************************************************************
+ Implementation of interfaces for the streaming prover and verifier.
+
+ See streaming.hpp .
+
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef STREAMING_TCC_
+#define STREAMING_TCC_
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
+#include "src/proof_system/prover.hpp"
+
+namespace bace {
+
+template<typename FieldT>
+void streaming_prover(const arithmetic_circuit_t<FieldT> &circuit,
+                      const mapped_input_batch_t<FieldT> &input_batch,
+                      proof_t<FieldT> &proof,
+                      const size_t &memory_budget,
+                      const std::string &scratch_directory)
+{
+    const size_t batch_size = input_batch.batch_size();
+    const size_t input_size = input_batch.input_size();
+    const size_t column_size = get_column_size(batch_size);
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+    const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
+
+    /*
+     * The proof is held throughout; half of the rest of the budget holds the
+     * block being transformed, and the other half reads ahead. A block is at
+     * least one column, then the values of all columns on a coset of 2 points.
+     */
+    const size_t proof_bytes = large_degree * sizeof(FieldT);
+    const size_t column_bytes = column_size * sizeof(FieldT);
+    const size_t block_budget = (memory_budget > proof_bytes) ? (memory_budget - proof_bytes) / 2 : 0;
+    if (block_budget < std::max(column_bytes, 2 * input_size * sizeof(FieldT)))
+    {
+        throw std::invalid_argument("streaming_prover: memory budget of " + std::to_string(memory_budget) +
+                                    " bytes cannot hold the proof and one block of the columns");
+    }
+    const size_t group_size = std::min(input_size, block_budget / column_bytes);
+
+    /* Column coefficients, a group of columns at a time */
+    mapped_file_t coefficient_file(scratch_directory, input_size * column_bytes);
+    FieldT *coefficients = reinterpret_cast<FieldT*>(coefficient_file.data());
+    {
+        column_lde_t<FieldT> group(group_size, column_size);
+        for (size_t i0 = 0; i0 < input_size; i0 += group_size)
+        {
+            const size_t i1 = std::min(i0 + group_size, input_size);
+            input_batch.will_need(i1, std::min(i1 + group_size, input_size));
+
+            for (size_t i = i0; i < i1; i++)
+            {
+                std::copy(input_batch.column(i), input_batch.column(i) + batch_size, group[i - i0]);
+                std::fill(group[i - i0] + batch_size, group[i - i0] + column_size, FieldT::zero());
+            }
+            column_domain->batch_iFFT(group.data(), i1 - i0);
+            std::copy(group.data(), group.data() + (i1 - i0) * column_size, coefficients + i0 * column_size);
+
+            input_batch.dont_need(i0, i1);
+            coefficient_file.dont_need(i0 * column_bytes, (i1 - i0) * column_bytes);
+        }
+    }
+
+    /* Largest coset whose values for all columns fit in the block budget */
+    size_t coset_size = column_size;
+    while (coset_size > 2 && input_size * coset_size * sizeof(FieldT) > block_budget) coset_size /= 2;
+    const size_t num_cosets = large_degree / coset_size;
+    const size_t num_chunks = column_size / coset_size;
+    const domain_t<FieldT> coset_domain = get_evaluation_domain<FieldT>(coset_size);
+
+    proof.resize(large_degree);
+    column_lde_t<FieldT> coset_lde(input_size, coset_size);
+    const std::vector<FieldT*> proofs { proof.data() };
+    evaluation_workspace_t<FieldT> workspace(compiled_circuit, coset_size);
+    std::vector<FieldT> shift_powers(coset_size);
+    const size_t stride = domain->coset_stride(coset_size);
+    for (size_t c = 0; c < num_cosets; c++)
+    {
+        const FieldT shift = domain->coset_shift(c, coset_size);
+        shift_powers[0] = FieldT::one();
+        for (size_t r = 1; r < coset_size; r++) shift_powers[r] = shift_powers[r - 1] * shift;
+        const FieldT chunk_shift = shift_powers[coset_size - 1] * shift; // shift^coset_size
+
+        /*
+         * column(shift * x) modulo x^coset_size - 1 has coefficients
+         * shift^r * sum_q a_{r + q * coset_size} * chunk_shift^q, evaluated
+         * by Horner's rule over the chunks of coset_size coefficients.
+         */
+        for (size_t i0 = 0; i0 < input_size; i0 += group_size)
+        {
+            const size_t i1 = std::min(i0 + group_size, input_size);
+            coefficient_file.will_need(i1 * column_bytes, (std::min(i1 + group_size, input_size) - i1) * column_bytes);
+
+#ifdef MULTICORE
+            #pragma omp parallel for
+#endif
+            for (size_t i = i0; i < i1; i++)
+            {
+                FieldT *folded = coset_lde[i];
+                const FieldT *column = coefficients + i * column_size;
+                std::copy(column + (num_chunks - 1) * coset_size, column + column_size, folded);
+                for (size_t q = num_chunks - 1; q-- > 0;)
+                {
+                    const FieldT *chunk = column + q * coset_size;
+                    for (size_t r = 0; r < coset_size; r++) folded[r] = folded[r] * chunk_shift + chunk[r];
+                }
+                for (size_t r = 1; r < coset_size; r++) folded[r] *= shift_powers[r];
+            }
+
+            coefficient_file.dont_need(i0 * column_bytes, (i1 - i0) * column_bytes);
+        }
+
+        coset_domain->batch_FFT(coset_lde.data(), input_size);
+        evaluate_coset(compiled_circuit, coset_lde.data(), input_size, coset_size,
+                       domain->coset_offset(c, coset_size), stride, proofs, workspace);
+    }
+    domain->iFFT(proof);
+}
+
+template<typename FieldT>
+void streaming_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                        const mapped_input_batch_t<FieldT> &input_batch,
+                        output_batch_t<FieldT> &output_batch,
+                        const proof_t<FieldT> &proof,
+                        const size_t &num_repetitions)
+{
+    streaming_verifier(circuit, input_batch, output_batch, proof.data(), proof.size(), num_repetitions);
+}
+
+template<typename FieldT>
+void streaming_verifier(const arithmetic_circuit_t<FieldT> &circuit,
+                        const mapped_input_batch_t<FieldT> &input_batch,
+                        output_batch_t<FieldT> &output_batch,
+                        const FieldT *proof,
+                        const size_t &proof_size,
+                        const size_t &num_repetitions)
+{
+    /* With no random element, any proof would pass */
+    if (num_repetitions == 0) throw std::invalid_argument("streaming_verifier: num_repetitions must be positive");
+
+    const size_t batch_size = input_batch.batch_size();
+    const size_t input_size = input_batch.input_size();
+    const size_t column_size = get_column_size(batch_size);
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+
+    std::vector<FieldT> random_elements(num_repetitions);
+    std::vector<std::vector<FieldT> > weights;
+    for (FieldT &random_element : random_elements)
+    {
+        random_element = FieldT::random_element();
+        weights.emplace_back(evaluate_lagrange_basis(column_size, batch_size, random_element));
+    }
+
+    /*
+     * Each column of the file is a contiguous range, read ahead one column
+     * early, and each of its values is loaded once for all random elements.
+     */
+    std::vector<input_t<FieldT> > random_inputs(num_repetitions, input_t<FieldT>(input_size, FieldT::zero()));
+    std::vector<FieldT> sums(num_repetitions);
+    for (size_t i = 0; i < input_size; i++)
+    {
+        input_batch.will_need(i + 1, std::min(i + 2, input_size));
+
+        const FieldT *column = input_batch.column(i);
+        std::fill(sums.begin(), sums.end(), FieldT::zero());
+        for (size_t t = 0; t < batch_size; t++)
+        {
+            const FieldT value = column[t];
+            for (size_t r = 0; r < num_repetitions; r++)
+            {
+                sums[r] += weights[r][t] * value;
+            }
+        }
+        for (size_t r = 0; r < num_repetitions; r++) random_inputs[r][i] = sums[r];
+        input_batch.dont_need(i, i + 1);
+    }
+
+    output_batch.clear();
+    if (proof_size > large_degree) return;
+
+    const std::vector<FieldT> outputs_mine = compiled_circuit.evaluate_outputs(random_inputs)[0];
+    const std::vector<FieldT> outputs_proof = evaluate_polynomial(proof, proof_size, random_elements);
+    if (outputs_mine == outputs_proof)
+    {
+        extract_output_batch(proof, proof_size, batch_size, output_batch);
+    }
+}
+
+} // bace
+
+#endif // STREAMING_TCC_
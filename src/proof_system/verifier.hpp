@@ -21,23 +21,35 @@ namespace bace {
  * and proof from the prover.
  *
  * The verifier first performs a probabilistic check of the proof provided by
- * the prover. The verifier constructs the column_lde_t and selects a random
- * field element, evaluating the random element on the columns to compose an
- * input vector of input_size. Then, the verifier evaluates this input vector
+ * the prover. The verifier selects a random field element and evaluates the
+ * columns of the column_lde_t at the random element to compose an input
+ * vector of input_size, directly from the input batch by barycentric
+ * interpolation (see evaluate_column_lde()). Then, the verifier evaluates this input vector
  * on the given circuit and evaluates the random field element on the proof to
  * verify that the two outputs match.
  *
  * If the two evaluations match, there is a large probability
  * that the proof is correct, and the verifier proceeds to derive
- * the batch of outputs from the proof. After evaluating on a large degree
- * by taking the FFT of the proof, the verifier selects the outputs, seperated
- * approximately degree indices apart by properties of the FFT.
+ * the batch of outputs from the proof. The outputs are the evaluations of
+ * the proof on the column domain, which the verifier obtains by folding the
+ * proof modulo X^column_size - 1 and taking a column_size FFT (see
+ * extract_output_batch()).
  *
  * random = FieldT::random_element()
  * random_input = [column_lde[1](random), ... , column_lde[input_size](random)]
  * output_mine = circuit.evaluate(random_input)
  * output_proof = proof(random)
  *
+ * The check is repeated at num_repetitions independent random elements,
+ * which is how small fields reach a target soundness (see
+ * get_num_repetitions()). The repetitions are fused rather than run one
+ * after the other: the columns are evaluated at all random elements in one
+ * pass over the input batch, the circuit evaluates all random inputs as a
+ * single block, and the proof is evaluated at all random elements in one
+ * Horner pass over its coefficients. num_repetitions must be at least 1, as
+ * no check at all would accept any proof: 0 throws std::invalid_argument,
+ * as it does for every verifier.
+ *
  * In the case that the outputs from the evaluation of the random input and
  * proof do not match, the verifier will return an empty vector as output. If
  * there is a size mismatch among the batch of inputs, the verifier will either
@@ -48,7 +60,43 @@ template<typename FieldT>
 void verifier(const arithmetic_circuit_t<FieldT> &circuit,
               const input_batch_t<FieldT> &input_batch,
               output_batch_t<FieldT> &output_batch,
-              const proof_t<FieldT> &proof);
+              const proof_t<FieldT> &proof,
+              const size_t &num_repetitions = 1);
+
+/*
+ * Same as above, for the proof_size leading coefficients of a proof held
+ * outside of a proof_t, the remaining ones up to large_degree being zero.
+ * This verifies a mapped_proof_t in place:
+ *
+ * verifier(circuit, input_batch, output_batch, proof.data(), proof.size())
+ *
+ * A proof with more than large_degree coefficients is rejected.
+ */
+template<typename FieldT>
+void verifier(const arithmetic_circuit_t<FieldT> &circuit,
+              const input_batch_t<FieldT> &input_batch,
+              output_batch_t<FieldT> &output_batch,
+              const FieldT *proof,
+              const size_t &proof_size,
+              const size_t &num_repetitions = 1);
+
+/*
+ * Returns one batch of outputs per proof, given the circuits, batch of
+ * inputs, and proofs returned by the prover for multiple circuits (one
+ * proof per output of the circuits, in order).
+ *
+ * All proofs are checked at the same num_repetitions random elements, so
+ * the random inputs are composed once and each circuit is evaluated once
+ * on them, for all its outputs. As above, the output batch of a proof that fails the check is
+ * left empty; if the number of proofs does not match the number of
+ * outputs, all output batches are left empty.
+ */
+template<typename FieldT>
+void verifier(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+              const input_batch_t<FieldT> &input_batch,
+              std::vector<output_batch_t<FieldT> > &output_batches,
+              const std::vector<proof_t<FieldT> > &proofs,
+              const size_t &num_repetitions = 1);
 
 } // bace
 
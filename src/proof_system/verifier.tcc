@@ -13,7 +13,10 @@
 #ifndef VERIFIER_TCC_
 #define VERIFIER_TCC_
 
-#include "polynomial_arithmetic/naive_evaluate.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
 
 namespace bace {
 
@@ -21,36 +24,108 @@ template<typename FieldT>
 void verifier(const arithmetic_circuit_t<FieldT> &circuit,
               const input_batch_t<FieldT> &input_batch,
               output_batch_t<FieldT> &output_batch,
-              const proof_t<FieldT> &proof)
+              const proof_t<FieldT> &proof,
+              const size_t &num_repetitions)
+{
+    verifier(circuit, input_batch, output_batch, proof.data(), proof.size(), num_repetitions);
+}
+
+template<typename FieldT>
+void verifier(const arithmetic_circuit_t<FieldT> &circuit,
+              const input_batch_t<FieldT> &input_batch,
+              output_batch_t<FieldT> &output_batch,
+              const FieldT *proof,
+              const size_t &proof_size,
+              const size_t &num_repetitions)
 {
+    /* With no random element, any proof would pass */
+    if (num_repetitions == 0) throw std::invalid_argument("verifier: num_repetitions must be positive");
+
     const size_t batch_size = input_batch.size();
-    const size_t input_size = get_input_size(input_batch);
     const size_t column_size = get_column_size(batch_size);
-    const size_t large_degree = get_large_degree(column_size, circuit.degree());
-    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const size_t large_degree = get_large_degree(column_size, compiled_circuit.degree());
+
+    output_batch.clear();
+    if (proof_size > large_degree) return;
 
-    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    /* All random elements share one pass over the batch, the circuit and the proof */
+    std::vector<FieldT> random_elements(num_repetitions);
+    for (FieldT &random_element : random_elements) random_element = FieldT::random_element();
+    INSTRUMENT_START(lde_start);
+    const std::vector<input_t<FieldT> > random_inputs = evaluate_column_lde(input_batch, column_size, random_elements);
+    INSTRUMENT_STOP(lde_start, PHASE_VERIFY_LDE);
 
-    const FieldT random_element = FieldT::random_element();
-    std::vector<FieldT> random_input(input_size);
-    for (size_t i = 0; i < input_size; i++)
+    INSTRUMENT_START(circuit_start);
+    const std::vector<FieldT> outputs_mine = compiled_circuit.evaluate_outputs(random_inputs)[0];
+    INSTRUMENT_STOP(circuit_start, PHASE_VERIFY_CIRCUIT);
+
+    INSTRUMENT_START(proof_start);
+    const std::vector<FieldT> outputs_proof = evaluate_polynomial(proof, proof_size, random_elements);
+    INSTRUMENT_STOP(proof_start, PHASE_VERIFY_PROOF);
+    if (outputs_mine == outputs_proof)
     {
-        random_input[i] = libfqfft::evaluate_polynomial(column_size, column_lde[i], random_element);
+        INSTRUMENT_START(extract_start);
+        extract_output_batch(proof, proof_size, batch_size, output_batch);
+        INSTRUMENT_STOP(extract_start, PHASE_EXTRACT_OUTPUT);
     }
-    
-    output_batch.clear();
-    const FieldT output_mine = circuit.evaluate(random_input);
-    const FieldT output_proof = libfqfft::evaluate_polynomial(large_degree, proof, random_element);
-    if (output_mine == output_proof)
+}
+
+template<typename FieldT>
+void verifier(const std::vector<arithmetic_circuit_t<FieldT> > &circuits,
+              const input_batch_t<FieldT> &input_batch,
+              std::vector<output_batch_t<FieldT> > &output_batches,
+              const std::vector<proof_t<FieldT> > &proofs,
+              const size_t &num_repetitions)
+{
+    /* With no random element, any proof would pass */
+    if (num_repetitions == 0) throw std::invalid_argument("verifier: num_repetitions must be positive");
+
+    const size_t batch_size = input_batch.size();
+    const size_t column_size = get_column_size(batch_size);
+
+    size_t degree = 0;
+    size_t num_outputs = 0;
+    for (const arithmetic_circuit_t<FieldT> &circuit : circuits)
     {
-        output_batch = proof;
-        domain->FFT(output_batch);
-        
-        for (size_t i = 0; i < batch_size; i++)
+        degree = std::max(degree, circuit.degree());
+        num_outputs += circuit.num_outputs();
+    }
+    const size_t large_degree = get_large_degree(column_size, degree);
+
+    output_batches.assign(proofs.size(), output_batch_t<FieldT>());
+    if (proofs.size() != num_outputs) return;
+
+    std::vector<FieldT> random_elements(num_repetitions);
+    for (FieldT &random_element : random_elements) random_element = FieldT::random_element();
+    INSTRUMENT_START(lde_start);
+    const std::vector<input_t<FieldT> > random_inputs = evaluate_column_lde(input_batch, column_size, random_elements);
+    INSTRUMENT_STOP(lde_start, PHASE_VERIFY_LDE);
+
+    size_t k = 0;
+    for (const arithmetic_circuit_t<FieldT> &circuit : circuits)
+    {
+        if (circuit.num_outputs() == 0) continue;
+
+        INSTRUMENT_START(circuit_start);
+        const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+        const std::vector<std::vector<FieldT> > outputs_mine = compiled_circuit.evaluate_outputs(random_inputs);
+        INSTRUMENT_STOP(circuit_start, PHASE_VERIFY_CIRCUIT);
+        for (const std::vector<FieldT> &output_mine : outputs_mine)
         {
-            output_batch[i] = output_batch[get_embedded_index(i, column_size, large_degree)];
+            const proof_t<FieldT> &proof = proofs[k];
+            INSTRUMENT_START(proof_start);
+            const bool accepted = proof.size() <= large_degree &&
+                output_mine == evaluate_polynomial(proof.data(), proof.size(), random_elements);
+            INSTRUMENT_STOP(proof_start, PHASE_VERIFY_PROOF);
+            if (accepted)
+            {
+                INSTRUMENT_START(extract_start);
+                extract_output_batch(proof, batch_size, output_batches[k]);
+                INSTRUMENT_STOP(extract_start, PHASE_EXTRACT_OUTPUT);
+            }
+            k++;
         }
-        output_batch.resize(batch_size);
     }
 }
 
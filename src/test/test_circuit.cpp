@@ -5,14 +5,19 @@
  * @copyright  MIT license (see LICENSE file)
  *****************************************************************************/
  
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "algebra/curves/mnt/mnt4/mnt4_pp.hpp"
 
 #include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
 
 using namespace bace;
 
@@ -76,11 +81,349 @@ void test_circuit_evaluate_quadratic_inner_product()
     assert(res == 424);
 }
 
+template<typename FieldT>
+void test_compiled_circuit_evaluate()
+{
+    /* Arithmetic circuit C over F_q with n variables
+     * C = (x_1 * x_2 * 3) + (x_1 + 5) * x_3 */
+    const size_t n = 3;
+    arithmetic_circuit_t<FieldT> C = arithmetic_circuit_t<FieldT>(n);
+
+    input_element_t<FieldT> c1 = { CONSTANT, { 0 } };
+    c1.value.constant = FieldT(3);
+    input_element_t<FieldT> c2 = { CONSTANT, { 0 } };
+    c2.value.constant = FieldT(5);
+
+    const input_element_t<FieldT> e1 = { VARIABLE, 1 };
+    const input_element_t<FieldT> e2 = { VARIABLE, 2 };
+    const input_element_t<FieldT> e3 = { VARIABLE, 3 };
+    const gate_t<FieldT> g1 = { PRODUCT, std::vector<input_element_t<FieldT> > { e1, e2, c1 } };
+    const int g1_number = C.add_gate(g1);
+    const gate_t<FieldT> g2 = { SUM, std::vector<input_element_t<FieldT> > { e1, c2 } };
+    const int g2_number = C.add_gate(g2);
+
+    const input_element_t<FieldT> e4 = { VARIABLE, g1_number };
+    const input_element_t<FieldT> e5 = { VARIABLE, g2_number };
+    const gate_t<FieldT> g3 = { PRODUCT, std::vector<input_element_t<FieldT> > { e5, e3 } };
+    const int g3_number = C.add_gate(g3);
+    const input_element_t<FieldT> e6 = { VARIABLE, g3_number };
+    const gate_t<FieldT> g4 = { SUM, std::vector<input_element_t<FieldT> > { e4, e6 } };
+    C.add_gate(g4);
+
+    /* The compiled plan reuses one scratch buffer across evaluations */
+    const compiled_circuit_t<FieldT> compiled = compiled_circuit_t<FieldT>(C);
+    std::vector<FieldT> scratch = compiled.get_scratch();
+    assert(compiled.num_gates() == 4);
+    assert(compiled.num_constants() == 2);
+    assert(compiled.degree() == C.degree());
+
+    const FieldT res = compiled.evaluate(std::vector<FieldT> { 2, 7, 6 }, scratch);
+    printf("%ld == 84\n", res.as_ulong());
+    assert(res == 84);
+
+    const std::vector<FieldT> input { 4, 1, 3 };
+    assert(compiled.evaluate(input, scratch) == C.evaluate(input));
+}
+
+template<typename FieldT>
+void test_compiled_circuit_evaluate_batch()
+{
+    /* Arithmetic circuit C over F_q with input_size variables */
+    const size_t input_size = 9;
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    /* Evaluate num_points points in blocks, including a partial last block */
+    const size_t block_size = 4;
+    const size_t num_points = 10;
+    const compiled_circuit_t<FieldT> compiled = compiled_circuit_t<FieldT>(circuit);
+    std::vector<FieldT> scratch = compiled.get_batch_scratch(block_size);
+    assert(compiled.num_slots() < circuit.size());
+
+    input_batch_t<FieldT> input_batch(num_points, std::vector<FieldT>(input_size));
+    for (size_t i = 0; i < num_points; i++)
+    {
+        for (size_t j = 0; j < input_size; j++) input_batch[i][j] = FieldT::random_element();
+    }
+
+    std::vector<FieldT> output(num_points);
+    for (size_t i = 0; i < num_points; i += block_size)
+    {
+        const size_t count = std::min(block_size, num_points - i);
+        for (size_t j = 0; j < input_size; j++)
+        {
+            for (size_t p = 0; p < count; p++) scratch[j * block_size + p] = input_batch[i + p][j];
+        }
+        compiled.evaluate_batch(scratch, block_size, count, &output[i]);
+    }
+
+    for (size_t i = 0; i < num_points; i++)
+    {
+        assert(output[i] == circuit.evaluate(input_batch[i]));
+    }
+}
+
+template<typename FieldT>
+void test_circuit_evaluate_outputs()
+{
+    /* Arithmetic circuit C over F_q with input_size variables */
+    const size_t input_size = 6;
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    assert(circuit.outputs() == std::vector<int> { (int) circuit.size() });
+
+    /* The first product gate is an intermediate value, read by a later sum gate */
+    const int first_gate = input_size + 1;
+    circuit.add_output(circuit.size());
+    circuit.add_output(first_gate);
+    assert(circuit.num_outputs() == 2);
+
+    const size_t block_size = 4;
+    const size_t num_points = 3;
+    const compiled_circuit_t<FieldT> compiled = compiled_circuit_t<FieldT>(circuit);
+    std::vector<FieldT> scratch = compiled.get_scratch();
+    std::vector<FieldT> batch_scratch = compiled.get_batch_scratch(block_size);
+    assert(compiled.num_outputs() == 2);
+
+    input_batch_t<FieldT> input_batch(num_points, std::vector<FieldT>(input_size));
+    for (size_t i = 0; i < num_points; i++)
+    {
+        for (size_t j = 0; j < input_size; j++)
+        {
+            input_batch[i][j] = FieldT::random_element();
+            batch_scratch[j * block_size + i] = input_batch[i][j];
+        }
+    }
+
+    std::vector<FieldT> output(2 * block_size);
+    compiled.evaluate_batch_outputs(batch_scratch, block_size, num_points, output.data());
+    for (size_t i = 0; i < num_points; i++)
+    {
+        const std::vector<FieldT> outputs = circuit.evaluate_outputs(input_batch[i]);
+        assert(outputs[1] == input_batch[i][0] * input_batch[i][0]);
+        assert(outputs[0] == circuit.evaluate(input_batch[i]));
+        assert(compiled.evaluate_outputs(input_batch[i], scratch) == outputs);
+        assert(output[i] == outputs[0] && output[block_size + i] == outputs[1]);
+    }
+}
+
+template<typename FieldT>
+void test_compiled_circuit_levels()
+{
+    /* A wide level of products, reduced by gates of large fan-in */
+    const size_t n = 8;
+    const size_t width = LEVEL_MIN_OPERANDS;
+    arithmetic_circuit_t<FieldT> C = arithmetic_circuit_t<FieldT>(n);
+
+    std::vector<input_element_t<FieldT> > products;
+    for (size_t i = 0; i < width; i++)
+    {
+        input_element_t<FieldT> c = { CONSTANT, { 0 } };
+        c.value.constant = FieldT(i + 1);
+        const input_element_t<FieldT> e1 = { VARIABLE, (int) (i % n + 1) };
+        const input_element_t<FieldT> e2 = { VARIABLE, (int) ((i + 1) % n + 1) };
+        const gate_t<FieldT> g = { PRODUCT, std::vector<input_element_t<FieldT> > { e1, e2, c } };
+        const input_element_t<FieldT> e = { VARIABLE, C.add_gate(g) };
+        products.emplace_back(e);
+    }
+
+    const gate_t<FieldT> sum = { SUM, products };
+    const input_element_t<FieldT> e1 = { VARIABLE, C.add_gate(sum) };
+    const gate_t<FieldT> product = { PRODUCT, std::vector<input_element_t<FieldT> >(products.begin(), products.begin() + 2 * REDUCTION_MIN_FAN_IN) };
+    const input_element_t<FieldT> e2 = { VARIABLE, C.add_gate(product) };
+    const gate_t<FieldT> output = { SUM, std::vector<input_element_t<FieldT> > { e1, e2 } };
+    C.add_gate(output);
+
+    const compiled_circuit_t<FieldT> compiled = compiled_circuit_t<FieldT>(C);
+    assert(compiled.num_gates() == width + 3);
+    assert(compiled.num_levels() == 3);
+    assert(compiled.is_level_parallel());
+
+    /* Level by level, sequential and batched evaluations agree */
+    std::vector<input_t<FieldT> > inputs;
+    for (size_t p = 0; p < 3; p++)
+    {
+        input_t<FieldT> input;
+        for (size_t j = 0; j < n; j++) input.emplace_back(FieldT::random_element());
+        inputs.emplace_back(input);
+    }
+
+    std::vector<FieldT> scratch = compiled.get_scratch();
+    const std::vector<std::vector<FieldT> > outputs = compiled.evaluate_outputs(inputs);
+    for (size_t p = 0; p < inputs.size(); p++)
+    {
+        const FieldT expected = C.evaluate(inputs[p]);
+        assert(compiled.evaluate(inputs[p], scratch) == expected);
+        assert(outputs[0][p] == expected);
+
+        std::copy(inputs[p].begin(), inputs[p].end(), scratch.begin());
+        compiled.evaluate_levels(scratch);
+        assert(scratch[n + width + 2] == expected);
+    }
+
+    /* A deep chain, however large, has no parallel work and stays sequential */
+    const size_t depth = 2 * LEVEL_MIN_OPERANDS;
+    arithmetic_circuit_t<FieldT> chain = arithmetic_circuit_t<FieldT>(n);
+    input_element_t<FieldT> previous = { VARIABLE, 1 };
+    for (size_t i = 0; i < depth; i++)
+    {
+        const input_element_t<FieldT> e = { VARIABLE, (int) (i % n + 1) };
+        const gate_t<FieldT> g = { i % 2 == 0 ? SUM : PRODUCT, std::vector<input_element_t<FieldT> > { previous, e } };
+        previous.value.variable = chain.add_gate(g);
+    }
+
+    const compiled_circuit_t<FieldT> compiled_chain = compiled_circuit_t<FieldT>(chain);
+    assert(compiled_chain.num_levels() == depth);
+    assert(!compiled_chain.is_level_parallel());
+    std::vector<FieldT> chain_scratch = compiled_chain.get_scratch();
+    assert(compiled_chain.evaluate(inputs[0], chain_scratch) == chain.evaluate(inputs[0]));
+}
+
+template<typename FieldT>
+void test_circuit_optimize()
+{
+    /* The copies of the sum of squares collapse into one */
+    const size_t input_size = 16;
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    const arithmetic_circuit_t<FieldT> original = circuit;
+
+    const optimization_stats_t stats = circuit.optimize();
+    assert(stats.gates_before == original.size() - input_size);
+    assert(stats.gates_after == circuit.size() - input_size);
+    assert(stats.gates_after == input_size + 2); // mid squares, mid products and two sums
+    assert(circuit.degree() == original.degree());
+    assert(circuit.num_outputs() == 1);
+
+    std::vector<FieldT> input(input_size);
+    for (size_t j = 0; j < input_size; j++) input[j] = FieldT::random_element();
+    assert(circuit.evaluate(input) == original.evaluate(input));
+
+    /* C = ((x_1 * 1) + (2 + 3)) * ((x_2 + 0) + x_3), with an unused gate x_1 * x_2 */
+    arithmetic_circuit_t<FieldT> C = arithmetic_circuit_t<FieldT>(3);
+    input_element_t<FieldT> zero = { CONSTANT, { 0 } };
+    zero.value.constant = FieldT::zero();
+    input_element_t<FieldT> one = { CONSTANT, { 0 } };
+    one.value.constant = FieldT::one();
+    input_element_t<FieldT> two = { CONSTANT, { 0 } };
+    two.value.constant = FieldT(2);
+    input_element_t<FieldT> three = { CONSTANT, { 0 } };
+    three.value.constant = FieldT(3);
+
+    const input_element_t<FieldT> x1 = { VARIABLE, 1 };
+    const input_element_t<FieldT> x2 = { VARIABLE, 2 };
+    const input_element_t<FieldT> x3 = { VARIABLE, 3 };
+    const input_element_t<FieldT> g1 = { VARIABLE, C.add_gate({ PRODUCT, { x1, one } }) };
+    const input_element_t<FieldT> g2 = { VARIABLE, C.add_gate({ SUM, { two, three } }) };
+    const input_element_t<FieldT> g3 = { VARIABLE, C.add_gate({ SUM, { g1, g2 } }) };
+    C.add_gate({ PRODUCT, { x1, x2 } });
+    const input_element_t<FieldT> g5 = { VARIABLE, C.add_gate({ SUM, { x2, zero } }) };
+    const input_element_t<FieldT> g6 = { VARIABLE, C.add_gate({ SUM, { g5, x3 } }) };
+    C.add_gate({ PRODUCT, { g3, g6 } });
+    const arithmetic_circuit_t<FieldT> C_original = C;
+
+    /* Left are x_1 + 5, x_2 + x_3 and their product */
+    const optimization_stats_t C_stats = C.optimize();
+    assert(C_stats.gates_before == 7 && C_stats.gates_after == 3);
+    assert(C_stats.folded == 3 && C_stats.removed == 1);
+    assert(C.degree() == C_original.degree());
+
+    const std::vector<FieldT> C_input { 4, 1, 3 };
+    assert(C.evaluate(C_input) == C_original.evaluate(C_input));
+    assert(C.evaluate(C_input) == FieldT(36));
+
+    /* D = x_3 + x_1 * x_2 * 0, with an unused gate x_1 * x_2 * x_3 of the highest degree */
+    arithmetic_circuit_t<FieldT> D = arithmetic_circuit_t<FieldT>(3);
+    D.add_gate({ PRODUCT, { x1, x2, x3 } });
+    const input_element_t<FieldT> h2 = { VARIABLE, D.add_gate({ PRODUCT, { x1, x2, zero } }) };
+    D.add_gate({ SUM, { x3, h2 } });
+    const arithmetic_circuit_t<FieldT> D_original = D;
+
+    /* Left is x_3, of degree 1, but the degree and so the proofs are kept */
+    const optimization_stats_t D_stats = D.optimize();
+    assert(D_stats.gates_after == 1 && D_stats.removed == 1);
+    assert(D.degrees().back() == 1);
+    assert(D.degree() == 3 && D_original.degree() == 3);
+    assert(D.evaluate(C_input) == D_original.evaluate(C_input));
+
+    const compiled_circuit_t<FieldT> D_compiled(D);
+    assert(D_compiled.degree() == 3 && D_compiled.to_circuit().degree() == 3);
+}
+
+template<typename FieldT>
+void test_circuit_file()
+{
+    const size_t input_size = 6;
+
+    /* Two outputs, one of them through a gate with a constant */
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    const int sum_number = circuit.size();
+    input_element_t<FieldT> c1 = { CONSTANT, { 0 } };
+    c1.value.constant = FieldT(7);
+    const input_element_t<FieldT> e1 = { VARIABLE, sum_number };
+    const input_element_t<FieldT> e2 = { VARIABLE, 2 };
+    const int product_number = circuit.add_gate(gate_t<FieldT> { PRODUCT, std::vector<input_element_t<FieldT> > { e1, e2, c1 } });
+    circuit.add_output(product_number);
+    circuit.add_output(sum_number);
+
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+    const std::string path = "test_circuit_file.bin";
+    compiled_circuit.write(path);
+
+    const compiled_circuit_t<FieldT> loaded_circuit(path);
+    assert(loaded_circuit.num_inputs() == input_size);
+    assert(loaded_circuit.num_gates() == compiled_circuit.num_gates());
+    assert(loaded_circuit.num_constants() == 1);
+    assert(loaded_circuit.num_outputs() == 2);
+    assert(loaded_circuit.degree() == circuit.degree());
+    assert(loaded_circuit.num_slots() == compiled_circuit.num_slots());
+
+    const arithmetic_circuit_t<FieldT> decompiled_circuit = loaded_circuit.to_circuit();
+    assert(decompiled_circuit.size() == circuit.size());
+    std::vector<FieldT> scratch = loaded_circuit.get_scratch();
+    for (size_t n = 0; n < 4; n++)
+    {
+        std::vector<FieldT> input(input_size);
+        for (size_t i = 0; i < input_size; i++) input[i] = FieldT::random_element();
+        const std::vector<FieldT> outputs = circuit.evaluate_outputs(input);
+        assert(loaded_circuit.evaluate_outputs(input, scratch) == outputs);
+        assert(decompiled_circuit.evaluate_outputs(input) == outputs);
+    }
+
+    /* A corrupted degree in the header is rejected */
+    FILE *file = fopen(path.c_str(), "r+b");
+    const uint64_t degree = circuit.degree() + 1;
+    fseek(file, offsetof(serialization_header_t, degree), SEEK_SET);
+    fwrite(&degree, sizeof(degree), 1, file);
+    fclose(file);
+    bool rejected = false;
+    try { compiled_circuit_t<FieldT> corrupted(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+
+    /* A corrupted gate table is rejected */
+    compiled_circuit.write(path);
+    file = fopen(path.c_str(), "r+b");
+    fseek(file, -4, SEEK_END);
+    fputc(0x7f, file);
+    fclose(file);
+    rejected = false;
+    try { compiled_circuit_t<FieldT> corrupted(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+    remove(path.c_str());
+}
+
 int main()
 {
     libff::mnt4_pp::init_public_params();
     test_circuit_evaluate<libff::Fr<libff::mnt4_pp> >();
     test_circuit_evaluate_inner_product<libff::Fr<libff::mnt4_pp> >();
     test_circuit_evaluate_quadratic_inner_product<libff::Fr<libff::mnt4_pp> >();
+    test_compiled_circuit_evaluate<libff::Fr<libff::mnt4_pp> >();
+    test_compiled_circuit_evaluate_batch<libff::Fr<libff::mnt4_pp> >();
+    test_circuit_evaluate_outputs<libff::Fr<libff::mnt4_pp> >();
+    test_compiled_circuit_levels<libff::Fr<libff::mnt4_pp> >();
+    test_circuit_optimize<libff::Fr<libff::mnt4_pp> >();
+    test_circuit_file<libff::Fr<libff::mnt4_pp> >();
     return 0;
 }
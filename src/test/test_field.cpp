@@ -0,0 +1,94 @@
+/** @file
+ *****************************************************************************
+ * @author     This file is part of bace, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include <cassert>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/field/fp64.hpp"
+#include "src/proof_system/prover.hpp"
+#include "src/proof_system/verifier.hpp"
+#include "src/proof_system/naive_evaluation.hpp"
+
+using namespace bace;
+
+template<typename FieldT>
+void test_field_arithmetic()
+{
+    const uint64_t p = GOLDILOCKS_MODULUS;
+    assert(FieldT::s == 32);
+    assert(FieldT::size_in_bits() == 64);
+
+    /* Reference arithmetic on canonical representatives */
+    for (size_t i = 0; i < 1000; i++)
+    {
+        const FieldT a = FieldT::random_element();
+        const FieldT b = FieldT::random_element();
+        const unsigned __int128 x = a.as_ulong();
+        const unsigned __int128 y = b.as_ulong();
+
+        assert((a + b).as_ulong() == (x + y) % p);
+        assert((a - b).as_ulong() == (x + p - y) % p);
+        assert((a * b).as_ulong() == (x * y) % p);
+        assert((-a).as_ulong() == (p - x) % p);
+        if (!a.is_zero()) assert(a * a.inverse() == FieldT::one());
+    }
+
+    /* Values close to the word size, where the sum overflows */
+    const FieldT minus_one = -FieldT::one();
+    assert(minus_one.as_ulong() == p - 1);
+    assert(minus_one + minus_one == FieldT(-2));
+    assert(minus_one * minus_one == FieldT::one());
+    assert(FieldT(3) - FieldT(5) == FieldT(-2));
+    assert(FieldT(p, true).is_zero());
+
+    /* root_of_unity has order exactly 2^s */
+    assert((FieldT::root_of_unity ^ (1ul << FieldT::s)) == FieldT::one());
+    assert((FieldT::root_of_unity ^ (1ul << (FieldT::s - 1))) == minus_one);
+}
+
+template<typename FieldT>
+void test_field_verifier()
+{
+    const size_t input_size = 8;
+    const size_t batch_size = 20;
+    input_batch_t<FieldT> input_batch(batch_size, std::vector<FieldT>(input_size));
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        for (size_t j = 0; j < input_size; j++) input_batch[i][j] = FieldT::random_element();
+    }
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+
+    /* A 64-bit field needs several checks for 128 bits of security */
+    const size_t large_degree = get_large_degree(get_column_size(batch_size), circuit.degree());
+    const size_t num_repetitions = get_num_repetitions<FieldT>(large_degree, 128);
+    assert(num_repetitions == 3);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    verifier(circuit, input_batch, output_batch, proof, num_repetitions);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+
+    proof[1] += FieldT::one();
+    verifier(circuit, input_batch, output_batch, proof, num_repetitions);
+    assert(output_batch.empty());
+}
+
+int main()
+{
+    test_field_arithmetic<fp64_t>();
+    test_field_verifier<fp64_t>();
+    return 0;
+}
@@ -5,20 +5,44 @@
  * @copyright  MIT license (see LICENSE file)
  *****************************************************************************/
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "algebra/curves/mnt/mnt4/mnt4_pp.hpp"
 
 #include "src/arithmetic_circuit/arithmetic_circuit.hpp"
+#include "src/arithmetic_circuit/compiled_circuit.hpp"
 #include "src/proof_system/prover.hpp"
 #include "src/proof_system/verifier.hpp"
+#include "src/proof_system/batch_verifier.hpp"
 #include "src/proof_system/naive_evaluation.hpp"
+#include "src/proof_system/proving_context.hpp"
+#include "src/proof_system/proving_service.hpp"
+#include "src/proof_system/serialization.hpp"
+#include "src/proof_system/sharded_prover.hpp"
+#include "src/proof_system/stratified_prover.hpp"
+#include "src/proof_system/streaming.hpp"
 
 using namespace bace;
 
+/* Returns a batch of batch_size random inputs of input_size elements */
+template<typename FieldT>
+input_batch_t<FieldT> random_input_batch(const size_t &batch_size, const size_t &input_size)
+{
+    input_batch_t<FieldT> input_batch(batch_size, input_t<FieldT>(input_size));
+    for (input_t<FieldT> &input : input_batch)
+    {
+        for (FieldT &value : input) value = FieldT::random_element();
+    }
+    return input_batch;
+}
+
 template<typename FieldT>
 void test_verifier()
 {
@@ -62,9 +86,847 @@ void test_verifier()
     }
 }
 
+template<typename FieldT>
+void test_domain_cache()
+{
+    clear_domain_cache<FieldT>();
+
+    /* Cached transforms match the libfqfft radix-2 domain */
+    const size_t domain_size = 64;
+    std::vector<FieldT> a(domain_size);
+    for (size_t i = 0; i < domain_size; i++) a[i] = FieldT::random_element();
+    std::vector<FieldT> b(a);
+
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(domain_size);
+    libfqfft::basic_radix2_domain<FieldT> reference(domain_size);
+    domain->FFT(a);
+    reference.FFT(b);
+    assert(a == b);
+    domain->iFFT(a);
+    reference.iFFT(b);
+    assert(a == b);
+
+    /* Repeated lookups of the same size share one domain */
+    assert(get_evaluation_domain<FieldT>(domain_size) == domain);
+    get_evaluation_domain<FieldT>(2 * domain_size);
+
+    const domain_cache_stats_t stats = get_domain_cache_stats<FieldT>();
+    assert(stats.hits == 1 && stats.misses == 2 && stats.num_domains == 2);
+    assert(stats.memory_footprint >= 3 * domain_size * 2 * sizeof(FieldT));
+}
+
+template<typename FieldT>
+void test_single_input_batch()
+{
+    /* The smallest column is the radix-2 domain of 2 points */
+    assert(get_column_size(1) == 2);
+    assert(get_column_size(2) == 2);
+    assert(get_column_size(3) == 4);
+
+    const size_t input_size = 4;
+    arithmetic_circuit_t<FieldT> circuit(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(1, input_size);
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+    output_batch_t<FieldT> output_batch, output_batch_naive;
+    verifier(circuit, input_batch, output_batch, proof);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch.size() == 1 && output_batch == output_batch_naive);
+}
+
+template<typename FieldT>
+void test_coset_prover()
+{
+    const size_t input_size = 5;
+    const size_t batch_size = 6;
+    const size_t column_size = get_column_size(batch_size);
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+
+    /* Degree 2 and 3: two cosets of a domain of 16 points, three of a domain of 24 */
+    std::vector<arithmetic_circuit_t<FieldT> > circuits(2, arithmetic_circuit_t<FieldT>(input_size));
+    circuits[0].add_inner_product_gates();
+    circuits[1].add_quadratic_inner_product_gates();
+    for (const arithmetic_circuit_t<FieldT> &circuit : circuits)
+    {
+        /* Coset by coset extension matches zero-padded FFTs over the large domain */
+        const size_t large_degree = get_large_degree(column_size, circuit.degree());
+        const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(large_degree);
+        std::vector<std::vector<FieldT> > columns(input_size, std::vector<FieldT>(large_degree, FieldT::zero()));
+        for (size_t i = 0; i < input_size; i++)
+        {
+            std::copy(column_lde[i], column_lde[i] + column_size, columns[i].begin());
+            domain->FFT(columns[i]);
+        }
+
+        proof_t<FieldT> expected(large_degree);
+        input_t<FieldT> point(input_size);
+        for (size_t t = 0; t < large_degree; t++)
+        {
+            for (size_t i = 0; i < input_size; i++) point[i] = columns[i][t];
+            expected[t] = circuit.evaluate(point);
+        }
+        domain->iFFT(expected);
+
+        proof_t<FieldT> proof;
+        prover(circuit, input_batch, proof);
+        assert(large_degree / column_size > 1);
+        assert(proof == expected);
+    }
+}
+
+template<typename FieldT>
+void test_batched_transforms()
+{
+    const size_t input_size = 5;
+    const size_t batch_size = 13;
+    const size_t column_size = get_column_size(batch_size);
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    /* The contiguous column_lde_t holds the iFFT of each zero-padded column */
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    assert(column_lde.num_columns() == input_size && column_lde.column_size() == column_size);
+    libfqfft::basic_radix2_domain<FieldT> reference(column_size);
+    for (size_t i = 0; i < input_size; i++)
+    {
+        std::vector<FieldT> column(column_size, FieldT::zero());
+        for (size_t t = 0; t < batch_size; t++) column[t] = input_batch[t][i];
+        reference.iFFT(column);
+        assert(std::equal(column.begin(), column.end(), column_lde[i]));
+    }
+
+    /* Batched transforms match the transforms of each column on its own */
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(column_size);
+    const FieldT shift = FieldT::multiplicative_generator;
+    column_lde_t<FieldT> values = column_lde;
+    column_lde_t<FieldT> coset_values = column_lde;
+    domain->batch_FFT(values.data(), input_size);
+    domain->batch_cosetFFT(coset_values.data(), input_size, shift);
+    for (size_t i = 0; i < input_size; i++)
+    {
+        std::vector<FieldT> column(column_lde[i], column_lde[i] + column_size);
+        std::vector<FieldT> coset_column(column);
+        reference.FFT(column);
+        reference.cosetFFT(coset_column, shift);
+        assert(std::equal(column.begin(), column.end(), values[i]));
+        assert(std::equal(coset_column.begin(), coset_column.end(), coset_values[i]));
+    }
+
+    domain->batch_iFFT(values.data(), input_size);
+    assert(std::equal(values.data(), values.data() + input_size * column_size, column_lde.data()));
+}
+
+template<typename FieldT>
+void test_extract_output_batch()
+{
+    const size_t input_size = 4;
+    const size_t batch_size = 7;
+    const size_t column_size = get_column_size(batch_size);
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+
+    /* Folding the proof onto the column domain evaluates it there */
+    const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    extract_output_batch(proof, batch_size, output_batch);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+    for (size_t t = 0; t < batch_size; t++)
+    {
+        assert(output_batch[t] == evaluate_polynomial(proof.data(), proof.size(), column_domain->omega ^ t));
+    }
+
+    /* The zero coefficients past the proof's degree may be left out */
+    const size_t proof_size = (column_size - 1) * circuit.degree() + 1;
+    assert(proof_size < proof.size() && proof[proof_size] == FieldT::zero());
+    output_batch_t<FieldT> output_batch_truncated;
+    extract_output_batch(proof.data(), proof_size, batch_size, output_batch_truncated);
+    assert(output_batch_truncated == output_batch);
+}
+
+template<typename FieldT>
+void test_mixed_radix_domain()
+{
+    /* Smallest k * 2^b covering (column_size - 1) * degree + 1 points */
+    assert(get_large_degree(8, 2) == 16);
+    assert(get_large_degree(8, 3) == 24);
+    assert(get_large_degree(4, 6) == 20);
+    assert(get_large_degree(4, 1) == 4);
+
+    for (const size_t domain_size : { 12, 20, 24 })
+    {
+        const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(domain_size);
+        assert(domain->size() == domain_size && domain->radix() * domain->m == domain_size);
+
+        /* Transforms agree with evaluation at the domain elements */
+        std::vector<FieldT> a(domain_size);
+        for (size_t i = 0; i < domain_size; i++) a[i] = FieldT::random_element();
+        std::vector<FieldT> values(a);
+        domain->FFT(values);
+        for (size_t i = 0; i < domain_size; i++)
+        {
+            const FieldT element = domain->get_domain_element(i);
+            assert(values[i] == evaluate_polynomial(a.data(), domain_size, element));
+            assert(domain->compute_vanishing_polynomial(element) == FieldT::zero());
+        }
+        domain->iFFT(values);
+        assert(values == a);
+
+        /* Cosets of the column domain, in which it is embedded */
+        const size_t column_size = 4;
+        const domain_t<FieldT> column_domain = get_evaluation_domain<FieldT>(column_size);
+        for (size_t c = 0; c < domain_size / column_size; c++)
+        {
+            const FieldT shift = domain->coset_shift(c, column_size);
+            const size_t offset = domain->coset_offset(c, column_size);
+            for (size_t t = 0; t < column_size; t++)
+            {
+                const size_t index = offset + domain->coset_stride(column_size) * t;
+                assert(domain->get_domain_element(index) == shift * (column_domain->omega ^ t));
+            }
+        }
+        const size_t index = get_embedded_index(3, column_size, domain_size);
+        assert(domain->get_domain_element(index) == (column_domain->omega ^ 3));
+    }
+
+    /* A batch of 5 on a degree-3 circuit has a large domain of 24 points */
+    const size_t input_size = 4;
+    const size_t batch_size = 5;
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    assert(circuit.degree() == 3);
+
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+    assert(proof.size() == 24);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    verifier(circuit, input_batch, output_batch, proof);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+}
+
+template<typename FieldT>
+void test_evaluate_column_lde()
+{
+    const size_t input_size = 3;
+    const size_t batch_size = 5;
+    const size_t column_size = get_column_size(batch_size);
+
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    /* Barycentric evaluation matches Horner evaluation of the column_lde_t */
+    const column_lde_t<FieldT> column_lde = compute_column_lde(input_batch, column_size);
+    const FieldT point = FieldT::random_element();
+    const std::vector<FieldT> evaluation = evaluate_column_lde(input_batch, column_size, point);
+    for (size_t i = 0; i < input_size; i++)
+    {
+        const std::vector<FieldT> column(column_lde[i], column_lde[i] + column_size);
+        assert(evaluation[i] == libfqfft::evaluate_polynomial(column_size, column, point));
+    }
+
+    /* Points of the column domain read the batch, or zero past its end */
+    const domain_t<FieldT> domain = get_evaluation_domain<FieldT>(column_size);
+    assert(evaluate_column_lde(input_batch, column_size, domain->omega ^ 2) == input_batch[2]);
+    assert(evaluate_column_lde(input_batch, column_size, domain->omega ^ 6)[0] == FieldT::zero());
+}
+
+template<typename FieldT>
+void test_streaming_prover()
+{
+    const size_t input_size = 6;
+    const size_t batch_size = 13;
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    const std::string path = "test_streaming_input.bin";
+    write_mapped_input_batch(path, input_batch);
+    const mapped_input_batch_t<FieldT> mapped_batch(path);
+    assert(mapped_batch.batch_size() == batch_size);
+    assert(mapped_batch.input_size() == input_size);
+    assert(mapped_batch.has_valid_checksum());
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+
+    /* Besides the proof, a budget of 4 points per column forces cosets smaller than the columns */
+    proof_t<FieldT> streamed_proof;
+    const size_t memory_budget = (proof.size() + 2 * input_size * 4) * sizeof(FieldT);
+    streaming_prover(circuit, mapped_batch, streamed_proof, memory_budget, ".");
+    assert(streamed_proof == proof);
+
+    /* A budget that cannot hold the proof and a coset of 2 points is rejected */
+    bool rejected = false;
+    try { streaming_prover(circuit, mapped_batch, streamed_proof, proof.size() * sizeof(FieldT), "."); }
+    catch (const std::invalid_argument &) { rejected = true; }
+    assert(rejected);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    streaming_verifier(circuit, mapped_batch, output_batch, streamed_proof, 3);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+
+    /* A wrong proof is rejected at one repetition, and none is refused */
+    streamed_proof[0] += FieldT::one();
+    streaming_verifier(circuit, mapped_batch, output_batch, streamed_proof);
+    assert(output_batch.empty());
+    rejected = false;
+    try { streaming_verifier(circuit, mapped_batch, output_batch, streamed_proof, 0); }
+    catch (const std::invalid_argument &) { rejected = true; }
+    assert(rejected);
+
+    /* A corrupted input is caught when the batch is opened */
+    FILE *file = fopen(path.c_str(), "r+b");
+    fseek(file, -1, SEEK_END);
+    const int byte = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(byte ^ 1, file);
+    fclose(file);
+    rejected = false;
+    try { mapped_input_batch_t<FieldT> corrupted(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+
+    remove(path.c_str());
+}
+
+template<typename FieldT>
+void test_serialized_proof()
+{
+    const size_t input_size = 5;
+    const size_t batch_size = 11;
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+
+    const std::string path = "test_serialized_proof.bin";
+    write_proof(path, proof, batch_size, circuit.degree());
+    const mapped_proof_t<FieldT> mapped_proof(path);
+    assert(mapped_proof.has_valid_checksum());
+    assert(mapped_proof.large_degree() == proof.size());
+    assert(mapped_proof.size() == (get_column_size(batch_size) - 1) * circuit.degree() + 1);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    verifier(circuit, input_batch, output_batch, mapped_proof.data(), mapped_proof.size());
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+
+    /* A degree too low for the proof would drop coefficients, and is refused */
+    bool thrown = false;
+    try { write_proof(path, proof, batch_size, circuit.degree() - 1); } catch (const std::invalid_argument &) { thrown = true; }
+    assert(thrown);
+
+    /* A proof file is not read as an input batch */
+    bool rejected = false;
+    try { mapped_input_batch_t<FieldT> input(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+
+    /* A corrupted coefficient is caught when the proof is opened */
+    FILE *file = fopen(path.c_str(), "r+b");
+    fseek(file, sizeof(serialization_header_t), SEEK_SET);
+    const int byte = fgetc(file);
+    fseek(file, sizeof(serialization_header_t), SEEK_SET);
+    fputc(byte ^ 1, file);
+    fclose(file);
+    rejected = false;
+    try { mapped_proof_t<FieldT> corrupted(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+
+    /* So is a corrupted batch size in the header */
+    write_proof(path, proof, batch_size, circuit.degree());
+    file = fopen(path.c_str(), "r+b");
+    const uint64_t corrupted_batch_size = batch_size - 1;
+    fseek(file, offsetof(serialization_header_t, batch_size), SEEK_SET);
+    fwrite(&corrupted_batch_size, sizeof(corrupted_batch_size), 1, file);
+    fclose(file);
+    rejected = false;
+    try { mapped_proof_t<FieldT> corrupted(path); } catch (const std::runtime_error &) { rejected = true; }
+    assert(rejected);
+
+    remove(path.c_str());
+}
+
+template<typename FieldT>
+void test_multiple_circuits()
+{
+    const size_t input_size = 6;
+    const size_t batch_size = 7;
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    /* A two-output circuit of degree 3, and a circuit of degree 2 */
+    std::vector<arithmetic_circuit_t<FieldT> > circuits(2, arithmetic_circuit_t<FieldT>(input_size));
+    circuits[0].add_quadratic_inner_product_gates();
+    circuits[0].add_output(circuits[0].size());
+    circuits[0].add_output(input_size + 1);
+    circuits[1].add_inner_product_gates();
+
+    std::vector<proof_t<FieldT> > proofs;
+    prover(circuits, input_batch, proofs);
+    assert(proofs.size() == 3);
+
+    /* The first output's proof is the single-circuit proof */
+    proof_t<FieldT> proof;
+    prover(circuits[0], input_batch, proof);
+    assert(proofs[0] == proof);
+
+    std::vector<output_batch_t<FieldT> > output_batches;
+    std::vector<output_batch_t<FieldT> > output_batches_naive;
+    verifier(circuits, input_batch, output_batches, proofs);
+    naive_evaluate(circuits, input_batch, output_batches_naive);
+    assert(output_batches == output_batches_naive);
+
+    /* Only the tampered proof is rejected */
+    proofs[1][0] += FieldT::one();
+    verifier(circuits, input_batch, output_batches, proofs);
+    assert(output_batches[0] == output_batches_naive[0]);
+    assert(output_batches[1].empty());
+    assert(output_batches[2] == output_batches_naive[2]);
+}
+
+template<typename FieldT>
+void test_multiple_points()
+{
+    const size_t input_size = 6;
+    const size_t batch_size = 10;
+    const size_t column_size = get_column_size(batch_size);
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    /* The fused passes agree with the single-point ones */
+    const std::vector<FieldT> points { FieldT::random_element(), FieldT::random_element(), FieldT::random_element() };
+    const std::vector<input_t<FieldT> > evaluations = evaluate_column_lde(input_batch, column_size, points);
+    const std::vector<FieldT> polynomial_evaluations = evaluate_polynomial(input_batch[0].data(), input_size, points);
+    for (size_t r = 0; r < points.size(); r++)
+    {
+        assert(evaluations[r] == evaluate_column_lde(input_batch, column_size, points[r]));
+        assert(polynomial_evaluations[r] == evaluate_polynomial(input_batch[0].data(), input_size, points[r]));
+    }
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    verifier(circuit, input_batch, output_batch, proof, 4);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+
+    proof[proof.size() - 1] += FieldT::one();
+    verifier(circuit, input_batch, output_batch, proof, 4);
+    assert(output_batch.empty());
+
+    /* The wrong proof is also rejected at the default and minimum of one repetition */
+    const std::vector<input_batch_t<FieldT> > input_batches { input_batch };
+    const std::vector<proof_t<FieldT> > proofs { proof };
+    std::vector<output_batch_t<FieldT> > output_batches;
+    verifier(circuit, input_batch, output_batch, proof);
+    assert(output_batch.empty());
+    verifier(circuit, input_batch, output_batch, proof, 1);
+    assert(output_batch.empty());
+    verifier(std::vector<arithmetic_circuit_t<FieldT> > { circuit }, input_batch, output_batches, proofs, 1);
+    assert(output_batches[0].empty());
+    assert(batch_verifier(circuit, input_batches, output_batches, proofs, 1).num_accepted == 0);
+
+    /* No repetition at all would accept it, so every verifier refuses 0 */
+    size_t num_refused = 0;
+    try { verifier(circuit, input_batch, output_batch, proof, 0); }
+    catch (const std::invalid_argument &) { num_refused++; }
+    try { verifier(std::vector<arithmetic_circuit_t<FieldT> > { circuit }, input_batch, output_batches, proofs, 0); }
+    catch (const std::invalid_argument &) { num_refused++; }
+    try { batch_verifier(circuit, input_batches, output_batches, proofs, 0); }
+    catch (const std::invalid_argument &) { num_refused++; }
+    assert(num_refused == 3);
+}
+
+template<typename FieldT>
+void test_batch_verifier()
+{
+    const size_t input_size = 6;
+    const size_t batch_size = 9;
+    const size_t num_proofs = 5;
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    std::vector<input_batch_t<FieldT> > input_batches(num_proofs);
+    std::vector<proof_t<FieldT> > proofs(num_proofs);
+    for (size_t n = 0; n < num_proofs; n++)
+    {
+        input_batches[n] = random_input_batch<FieldT>(batch_size, input_size);
+        prover(circuit, input_batches[n], proofs[n]);
+    }
+
+    /* A tampered proof, and an input batch of another shape */
+    proofs[1][2] += FieldT::one();
+    input_batches[3].pop_back();
+
+    std::vector<output_batch_t<FieldT> > output_batches;
+    const batch_verification_stats_t stats = batch_verifier(circuit, input_batches, output_batches, proofs, 2);
+    assert(stats.num_accepted == 3);
+    assert(stats.accepted == std::vector<bool>({ true, false, true, false, true }));
+
+    for (size_t n = 0; n < num_proofs; n++)
+    {
+        if (!stats.accepted[n])
+        {
+            assert(output_batches[n].empty());
+            continue;
+        }
+        output_batch_t<FieldT> output_batch_naive;
+        naive_evaluate(circuit, input_batches[n], output_batch_naive);
+        assert(output_batches[n] == output_batch_naive);
+    }
+
+    /* Fewer input batches than proofs are refused */
+    input_batches.pop_back();
+    bool thrown = false;
+    try { batch_verifier(circuit, input_batches, output_batches, proofs, 2); } catch (const std::invalid_argument &) { thrown = true; }
+    assert(thrown);
+}
+
+template<typename FieldT>
+void test_instrumentation()
+{
+    const size_t input_size = 4;
+    const size_t batch_size = 8;
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    const compiled_circuit_t<FieldT> compiled_circuit(circuit);
+
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    std::vector<phase_t> phases;
+    set_phase_callback([&phases](const phase_t &phase, const double &) { phases.emplace_back(phase); });
+
+    reset_instrumentation_stats();
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+    instrumentation_stats_t stats = get_instrumentation_stats();
+
+    if (!is_instrumented())
+    {
+        /* Compiled out: nothing is recorded */
+        assert(phases.empty());
+        assert(stats.counters[COUNTER_FFTS] == 0 && stats.calls[PHASE_COLUMN_LDE] == 0);
+        set_phase_callback(phase_callback_t());
+        return;
+    }
+
+    /* Column size 8, large degree 24: one LDE, three cosets, one iFFT */
+    const size_t large_degree = proof.size();
+    const size_t num_cosets = large_degree / batch_size;
+    assert(stats.calls[PHASE_COLUMN_LDE] == 1);
+    assert(stats.calls[PHASE_COSET_FFT] == num_cosets);
+    assert(stats.calls[PHASE_COSET_EVALUATION] == num_cosets);
+    assert(stats.calls[PHASE_PROOF_IFFT] == 1);
+    assert(phases.size() == 2 + 2 * num_cosets && phases.front() == PHASE_COLUMN_LDE && phases.back() == PHASE_PROOF_IFFT);
+    assert(stats.counters[COUNTER_FFTS] == input_size * (1 + num_cosets) + 1);
+    assert(stats.counters[COUNTER_FFT_ELEMENTS] == input_size * (1 + num_cosets) * batch_size + large_degree);
+    assert(stats.counters[COUNTER_GATES_EVALUATED] == compiled_circuit.num_gates() * large_degree);
+    assert(stats.counters[COUNTER_FIELD_MULTIPLICATIONS] > compiled_circuit.num_multiplications() * large_degree);
+    assert(stats.counters[COUNTER_BYTES_ALLOCATED] >= large_degree * sizeof(FieldT));
+
+    reset_instrumentation_stats();
+    output_batch_t<FieldT> output_batch;
+    verifier(circuit, input_batch, output_batch, proof, 3);
+    stats = get_instrumentation_stats();
+    assert(output_batch.size() == batch_size);
+    for (const phase_t &phase : { PHASE_VERIFY_LDE, PHASE_VERIFY_CIRCUIT, PHASE_VERIFY_PROOF, PHASE_EXTRACT_OUTPUT })
+    {
+        assert(stats.calls[phase] == 1);
+    }
+    assert(stats.counters[COUNTER_GATES_EVALUATED] == compiled_circuit.num_gates() * 3);
+    assert(stats.calls[PHASE_COLUMN_LDE] == 0);
+
+    set_phase_callback(phase_callback_t());
+}
+
+template<typename FieldT>
+void test_proving_context()
+{
+    const size_t input_size = 5;
+
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    proving_context_t<FieldT> context(circuit);
+    assert(context.batch_size() == 0 && context.arena_size() == 0);
+
+    /* Batches of one column size share the arena, the last one reshapes it */
+    size_t arena_size = 0;
+    for (const size_t batch_size : { 12, 12, 10, 3 })
+    {
+        const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+        proof_t<FieldT> proof, proof_context;
+        prover(circuit, input_batch, proof);
+        context.prove(input_batch, proof_context);
+        assert(proof_context == proof);
+        assert(context.batch_size() == batch_size);
+        if (batch_size != 3 && arena_size > 0) assert(context.arena_size() == arena_size);
+        arena_size = context.arena_size();
+
+        output_batch_t<FieldT> output_batch, output_batch_naive;
+        verifier(circuit, input_batch, output_batch, context.proof(), context.proof_size());
+        naive_evaluate(circuit, input_batch, output_batch_naive);
+        assert(output_batch == output_batch_naive);
+    }
+
+    /* Pinned threads and placed buffers leave the proof unchanged, and the affinity is restored */
+    assert(!get_numa_cpus().empty());
+    const std::vector<cpu_set_t> affinity = get_thread_affinity();
+    for (const char *name : { "local", "interleaved" })
+    {
+        const memory_placement_t placement = get_memory_placement(name);
+        assert(get_placement_name(placement) == name);
+
+        const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(12, input_size);
+
+        proof_t<FieldT> proof, proof_context;
+        prover(circuit, input_batch, proof);
+        proving_context_t<FieldT> placed_context(circuit, false, placement);
+        placed_context.prove(input_batch, proof_context);
+        assert(proof_context == proof);
+    }
+    const std::vector<cpu_set_t> restored_affinity = get_thread_affinity();
+    assert(restored_affinity.size() == affinity.size());
+    for (size_t t = 0; t < affinity.size(); t++) assert(CPU_EQUAL(&restored_affinity[t], &affinity[t]));
+}
+
+template<typename FieldT>
+void test_sharded_prover()
+{
+    const size_t input_size = 6;
+    const size_t batch_size = 10;
+
+    /* Degree 3 on a column domain of 16 points: 3 cosets of a large domain of 48 points */
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    proof_t<FieldT> proof;
+    prover(circuit, input_batch, proof);
+    for (const shard_transport_t transport : { SHARD_IN_PROCESS, SHARD_PROCESSES })
+    {
+        for (const size_t num_shards : { 1, 3, 8 })
+        {
+            proof_t<FieldT> proof_sharded;
+            const sharding_stats_t stats = sharded_prover(circuit, input_batch, proof_sharded, num_shards, transport);
+            assert(stats.num_shards == std::min<size_t>(num_shards, proof.size() / get_column_size(batch_size)));
+            assert(stats.num_failed == 0);
+            assert(proof_sharded == proof);
+        }
+    }
+
+    /* The shard of a failed worker is evaluated again by the coordinator */
+    proof_t<FieldT> proof_sharded;
+    const sharding_stats_t stats = sharded_prover(circuit, input_batch, proof_sharded, 3, SHARD_PROCESSES, 1);
+    assert(stats.num_shards == 3 && stats.num_failed == 1);
+    assert(proof_sharded == proof);
+}
+
+template<typename FieldT>
+void test_stratified_prover()
+{
+    const size_t input_size = 8;
+    const size_t batch_size = 10;
+    const input_batch_t<FieldT> input_batch = random_input_batch<FieldT>(batch_size, input_size);
+
+    /* Degree 3, with most gates of degree 1 and 2 */
+    arithmetic_circuit_t<FieldT> circuit = arithmetic_circuit_t<FieldT>(input_size);
+    circuit.add_quadratic_inner_product_gates();
+    const std::vector<size_t> degrees = circuit.degrees();
+    assert(degrees.size() == circuit.size());
+    assert(*std::max_element(degrees.begin(), degrees.end()) == circuit.degree());
+
+    proof_t<FieldT> proof;
+    proof_t<FieldT> proof_stratified;
+    prover(circuit, input_batch, proof);
+    const stratification_stats_t stats = stratified_prover(circuit, input_batch, proof_stratified);
+    assert(proof_stratified == proof);
+    assert(stats.num_strata > 1 && stats.num_extensions > 0);
+    assert(stats.gate_evaluations < circuit.gates().size() * proof.size());
+
+    /* A constant term and an output of lower degree than the circuit */
+    input_element_t<FieldT> c = { CONSTANT, { 0 } };
+    c.value.constant = FieldT(7);
+    const input_element_t<FieldT> e1 = { VARIABLE, 1 };
+    const input_element_t<FieldT> e2 = { VARIABLE, 2 };
+    const gate_t<FieldT> g = { PRODUCT, std::vector<input_element_t<FieldT> > { e1, e2, c } };
+    const input_element_t<FieldT> e3 = { VARIABLE, circuit.add_gate(g) };
+    const gate_t<FieldT> h = { SUM, std::vector<input_element_t<FieldT> > { e3, c, e1 } };
+    circuit.add_output(circuit.add_gate(h));
+
+    prover(circuit, input_batch, proof);
+    stratified_prover(circuit, input_batch, proof_stratified);
+    assert(proof_stratified == proof);
+
+    output_batch_t<FieldT> output_batch;
+    output_batch_t<FieldT> output_batch_naive;
+    verifier(circuit, input_batch, output_batch, proof_stratified);
+    naive_evaluate(circuit, input_batch, output_batch_naive);
+    assert(output_batch == output_batch_naive);
+
+    /* All outputs of a multi-output circuit, the first one still alone */
+    circuit.add_output(e3.value.variable);
+    circuit.add_output(circuit.size() - 2);
+    std::vector<proof_t<FieldT> > proofs;
+    std::vector<proof_t<FieldT> > proofs_stratified;
+    prover(std::vector<arithmetic_circuit_t<FieldT> > { circuit }, input_batch, proofs);
+    stratified_prover(circuit, input_batch, proofs_stratified);
+    assert(proofs_stratified.size() == 3 && proofs_stratified == proofs);
+    stratified_prover(circuit, input_batch, proof_stratified);
+    assert(proof_stratified == proofs[0]);
+}
+
+template<typename FieldT>
+void test_proving_service()
+{
+    const size_t input_size = 4;
+    const size_t num_requests = 12;
+
+    std::shared_ptr<arithmetic_circuit_t<FieldT> > circuit(new arithmetic_circuit_t<FieldT>(input_size));
+    circuit->add_quadratic_inner_product_gates();
+    std::shared_ptr<arithmetic_circuit_t<FieldT> > other_circuit(new arithmetic_circuit_t<FieldT>(input_size));
+    other_circuit->add_inner_product_gates();
+
+    std::vector<input_batch_t<FieldT> > input_batches(num_requests);
+    std::vector<std::future<proving_result_t<FieldT> > > results;
+    {
+        proving_service_t<FieldT> service(2, 4, 16, true);
+        for (size_t n = 0; n < num_requests; n++)
+        {
+            const size_t batch_size = 1 + n % 5;
+            input_batches[n] = random_input_batch<FieldT>(batch_size, input_size);
+            results.emplace_back(service.submit(n % 3 == 0 ? other_circuit : circuit, input_batches[n]));
+        }
+
+        /* A request of the wrong input size fails alone */
+        std::future<proving_result_t<FieldT> > failed = service.submit(circuit, input_batch_t<FieldT>(2, std::vector<FieldT>(1)));
+        bool thrown = false;
+        try { failed.get(); } catch (const std::invalid_argument &) { thrown = true; }
+        assert(thrown);
+
+        for (size_t n = 0; n < num_requests; n++) results[n].wait();
+        const proving_service_stats_t stats = service.stats();
+        assert(stats.num_requests == num_requests && stats.num_proofs <= num_requests);
+    }
+
+    for (size_t n = 0; n < num_requests; n++)
+    {
+        const arithmetic_circuit_t<FieldT> &request_circuit = (n % 3 == 0) ? *other_circuit : *circuit;
+        const proving_result_t<FieldT> result = results[n].get();
+        assert(result.input_batch == input_batches[n]);
+        for (size_t i = 0; i < input_batches[n].size(); i++)
+        {
+            assert(result.proof->input_batch[result.offset + i] == input_batches[n][i]);
+        }
+
+        output_batch_t<FieldT> output_batch, output_batch_naive;
+        naive_evaluate(request_circuit, input_batches[n], output_batch_naive);
+        assert(result.output_batch == output_batch_naive);
+
+        verifier(request_circuit, result.proof->input_batch, output_batch, result.proof->proof);
+        assert(output_batch.size() == result.proof->input_batch.size());
+    }
+
+    /*
+     * With the worker paused, the small requests queue up behind a large
+     * request for another circuit, and are coalesced into a single proof.
+     * Their results hold their own inputs and outputs only, while a request
+     * proved alone holds its proof.
+     */
+    const size_t num_small_requests = 8;
+    std::vector<input_batch_t<FieldT> > small_batches(num_small_requests);
+    {
+        proving_service_t<FieldT> service(1, num_small_requests + 1, 16);
+        service.pause();
+        std::future<proving_result_t<FieldT> > large = service.submit(other_circuit, random_input_batch<FieldT>(1ul << 10, input_size));
+        results.clear();
+        for (size_t n = 0; n < num_small_requests; n++)
+        {
+            small_batches[n] = random_input_batch<FieldT>(2, input_size);
+            results.emplace_back(service.submit(circuit, small_batches[n]));
+        }
+        service.resume();
+
+        const proving_result_t<FieldT> large_result = large.get();
+        assert(large_result.proof && large_result.proof->input_batch == large_result.input_batch);
+        for (size_t n = 0; n < num_small_requests; n++) results[n].wait();
+        const proving_service_stats_t stats = service.stats();
+        assert(stats.num_requests == num_small_requests + 1);
+        assert(stats.num_proofs == 2);
+    }
+
+    size_t num_coalesced = 0;
+    for (size_t n = 0; n < num_small_requests; n++)
+    {
+        const proving_result_t<FieldT> result = results[n].get();
+        assert(result.input_batch == small_batches[n]);
+        output_batch_t<FieldT> output_batch_naive;
+        naive_evaluate(*circuit, small_batches[n], output_batch_naive);
+        assert(result.output_batch == output_batch_naive);
+        if (!result.proof) num_coalesced++;
+    }
+    assert(num_coalesced == num_small_requests);
+
+    /* Without coalescing, every request gets a proof of its own inputs */
+    {
+        proving_service_t<FieldT> service(1, num_small_requests, 0);
+        results.clear();
+        for (size_t n = 0; n < num_small_requests; n++) results.emplace_back(service.submit(circuit, small_batches[n]));
+        for (size_t n = 0; n < num_small_requests; n++)
+        {
+            const proving_result_t<FieldT> result = results[n].get();
+            assert(result.proof && result.proof->input_batch == small_batches[n] && result.offset == 0);
+            output_batch_t<FieldT> output_batch;
+            verifier(*circuit, result.proof->input_batch, output_batch, result.proof->proof);
+            assert(output_batch == result.output_batch);
+        }
+        assert(service.stats().num_proofs == num_small_requests);
+    }
+}
+
 int main()
 {
     libff::mnt4_pp::init_public_params();
     test_verifier<libff::Fr<libff::mnt4_pp> >();
+    test_domain_cache<libff::Fr<libff::mnt4_pp> >();
+    test_single_input_batch<libff::Fr<libff::mnt4_pp> >();
+    test_coset_prover<libff::Fr<libff::mnt4_pp> >();
+    test_batched_transforms<libff::Fr<libff::mnt4_pp> >();
+    test_extract_output_batch<libff::Fr<libff::mnt4_pp> >();
+    test_mixed_radix_domain<libff::Fr<libff::mnt4_pp> >();
+    test_evaluate_column_lde<libff::Fr<libff::mnt4_pp> >();
+    test_streaming_prover<libff::Fr<libff::mnt4_pp> >();
+    test_serialized_proof<libff::Fr<libff::mnt4_pp> >();
+    test_multiple_circuits<libff::Fr<libff::mnt4_pp> >();
+    test_multiple_points<libff::Fr<libff::mnt4_pp> >();
+    test_batch_verifier<libff::Fr<libff::mnt4_pp> >();
+    test_instrumentation<libff::Fr<libff::mnt4_pp> >();
+    test_proving_context<libff::Fr<libff::mnt4_pp> >();
+    test_sharded_prover<libff::Fr<libff::mnt4_pp> >();
+    test_stratified_prover<libff::Fr<libff::mnt4_pp> >();
+    test_proving_service<libff::Fr<libff::mnt4_pp> >();
     return 0;
 }